@@ -0,0 +1,255 @@
+/**
+ * Hammer: A Reversi Minimax AI
+ * Copyright (C) 2024 marcus8448
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// move generation counts and fixed depth searches, to compare builds with, see usage()
+
+#include "engine.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define popcount(x) ((int)__popcnt64(x))
+#define ctz(x) ((int)_tzcnt_u64(x))
+#else
+#define popcount(x) __builtin_popcountll(x)
+#define ctz(x) __builtin_ctzll(x)
+#endif
+
+// leaves of the game tree from the start, by depth (passes count as a ply)
+static const uint64_t PERFT[] = {1,
+    4,
+    12,
+    56,
+    244,
+    1396,
+    8200,
+    55092,
+    390216,
+    3005288,
+    24571284,
+    212258800,
+    1939886636,
+    18429641748,
+    184042084512};
+
+// random boards (player to move, other player) from random games, by empty squares
+static const uint64_t BOARDS[][2] = {
+    {0x00442040E0100000ULL, 0x1418181818404000ULL}, // 44 empty
+    {0x09121A0200000000ULL, 0x0445645C1E100000ULL}, // 40
+    {0x001C1C1E10880400ULL, 0x002022A068343008ULL}, // 36
+    {0x3C3C3833CC040000ULL, 0x0002844C32302000ULL}, // 32
+    {0x000012000AF60200ULL, 0x000049FF74085C70ULL}, // 30
+    {0x1080786474424140ULL, 0x060E041808AC3A08ULL}, // 28
+    {0x011E3FDC10000010ULL, 0x100000202F3E1E0FULL}, // 26
+    {0x0038285269406010ULL, 0x38C6D62D960D1000ULL}, // 24
+    {0x6254B83818040210ULL, 0x10294687E6381C0CULL}, // 22
+    {0x41427D5830080422ULL, 0x841482A6CEB63818ULL}, // 20
+    {0x1E3F489010277C00ULL, 0x4080366FEF180020ULL}, // 18, solved from here on
+    {0x84E872E4E4102164ULL, 0x38100C1A1A2F5E08ULL}, // 17
+    {0x287CBC306F870308ULL, 0x0102000F907874F2ULL}, // 16
+    {0x0C1CBCAE998C2E14ULL, 0xF163435060701008ULL}, // 15
+    {0xA2053A262F262524ULL, 0x09FA44D9D0D8C040ULL}, // 14
+    {0xF0C1FEA080000222ULL, 0x0F3E005E787F1C18ULL}, // 14
+};
+
+// boards with at most this many empty squares are solved instead of searched to a fixed depth
+#define BENCH_SOLVE_EMPTIES 18
+// the book the ponder check plays from, written to the current directory and removed after
+#define BENCH_BOOK "hammer_bench.book"
+
+static void usage(const char *name) {
+  fprintf(stderr,
+      "usage: %s [options]\n"
+      "  -perft N      count the leaves to depth N from the start (default 9, 0 to skip)\n"
+      "  -depth N      depth to search the midgame boards to (default 10, 0 to skip)\n"
+      "  -solve B      whether to solve the endgame boards (default 1)\n"
+      "  -probcut B    whether to prune with ProbCut (default 1)\n"
+      "  -threads N    search threads (default 1, node counts vary with more)\n"
+      "  -hash MB      transposition table size\n"
+      "  -kernel NAME  move generation kernel: generic, avx2 or bmi2 (default: the fastest one)\n"
+      "  -mode NAME    how threads share the search: split or lazy (default split)\n"
+      "  -ponder B     whether to check pondering after a book move (default 1)\n"
+      "exits with 1 if a leaf count is wrong or pondering after a book move does nothing\n",
+      name);
+}
+
+static double seconds_since(const struct timespec *start) {
+  struct timespec now;
+  timespec_get(&now, TIME_UTC);
+  return difftime(now.tv_sec, start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/**
+ * \brief plays a book move with pondering on, and checks the ponder searched the move after it
+ * \return the deepest iteration the ponder completed, or -1 if the book couldn't be used
+ * \note this resets the game, and leaves pondering off and the book loaded
+ */
+static int ponder_after_book(void) {
+  if (engine_build_book(BENCH_BOOK, 2, 2) <= 0 || engine_load_book(BENCH_BOOK) <= 0) {
+    remove(BENCH_BOOK);
+    return -1;
+  }
+  engine_reset();
+  engine_set_ponder(true);
+  uint64_t player = 1ULL << 28 | 1ULL << 35;
+  uint64_t opponent = 1ULL << 27 | 1ULL << 36;
+  engine_play(&player, &opponent, engine_move(player, opponent, 2));
+  EngineStats stats;
+  engine_stats(&stats);
+  const bool book = stats.book;
+
+  // the opponent answers after giving the ponder some time
+  thrd_sleep(&(struct timespec){.tv_sec = 0, .tv_nsec = 100000000}, NULL);
+  engine_play(&player, &opponent, (uint8_t)ctz(engine_legal_moves(player, opponent)));
+  engine_move(player, opponent, 2);
+  engine_stats(&stats);
+  engine_set_ponder(false);
+  engine_reset();
+  remove(BENCH_BOOK);
+  return book ? stats.ponderDepth : -1;
+}
+
+int main(const int argc, char **argv) {
+  int perftDepth = 9;
+  int depth = 10;
+  int solve = 1;
+  int probcut = 1;
+  int threads = 1;
+  long long hash = 0;
+  const char *kernel = NULL;
+  int mode = SEARCH_SPLIT;
+  int ponder = 1;
+  for (int i = 1; i < argc; i += 2) {
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    bool valid = value != NULL;
+    if (valid && strcmp(argv[i], "-perft") == 0) {
+      perftDepth = atoi(value);
+      valid = perftDepth >= 0;
+    } else if (valid && strcmp(argv[i], "-depth") == 0) {
+      depth = atoi(value);
+      valid = depth >= 0 && depth <= BOARD_SIZE * BOARD_SIZE;
+    } else if (valid && strcmp(argv[i], "-solve") == 0) {
+      solve = atoi(value);
+    } else if (valid && strcmp(argv[i], "-probcut") == 0) {
+      probcut = atoi(value);
+    } else if (valid && strcmp(argv[i], "-threads") == 0) {
+      threads = atoi(value);
+      valid = threads > 0;
+    } else if (valid && strcmp(argv[i], "-hash") == 0) {
+      hash = atoll(value);
+      valid = hash > 0;
+    } else if (valid && strcmp(argv[i], "-kernel") == 0) {
+      kernel = value;
+    } else if (valid && strcmp(argv[i], "-mode") == 0) {
+      mode = strcmp(value, "lazy") == 0 ? SEARCH_LAZY : SEARCH_SPLIT;
+      valid = mode == SEARCH_LAZY || strcmp(value, "split") == 0;
+    } else if (valid && strcmp(argv[i], "-ponder") == 0) {
+      ponder = atoi(value);
+    } else {
+      valid = false;
+    }
+    if (!valid) {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if (!engine_init(threads) || (hash > 0 && !engine_set_hash_size((size_t)hash))) {
+    fprintf(stderr, "failed to start the engine\n");
+    return 1;
+  }
+  if (kernel != NULL && !engine_set_kernel(kernel)) {
+    fprintf(stderr, "kernel %s is not supported\n", kernel);
+    return 1;
+  }
+  printf("kernel: %s\n", engine_kernel());
+  engine_set_search_mode(mode);
+
+  if (!probcut) {
+    for (int phase = 0; phase < PROBCUT_PHASES; ++phase) {
+      engine_set_probcut(phase, 0);
+    }
+  }
+
+  int status = 0;
+  for (int d = 1; d <= perftDepth; ++d) {
+    struct timespec start;
+    timespec_get(&start, TIME_UTC);
+    const uint64_t leaves = engine_perft(1ULL << 27 | 1ULL << 36, 1ULL << 28 | 1ULL << 35, d);
+    const double seconds = seconds_since(&start);
+
+    const bool known = d < (int)(sizeof(PERFT) / sizeof(PERFT[0]));
+    const bool correct = !known || leaves == PERFT[d];
+    printf("perft %2i: %15llu %s %8.3fs %6.1f Mleaves/s\n",
+        d,
+        (unsigned long long)leaves,
+        !known ? "(unknown)" : (correct ? "(ok)     " : "(WRONG)  "),
+        seconds,
+        seconds > 0 ? leaves / seconds / 1e6 : 0.0);
+    if (!correct) status = 1;
+  }
+
+  if (ponder) {
+    const int pondered = ponder_after_book();
+    printf("ponder after a book move: depth %i %s\n", pondered, pondered > 0 ? "(ok)" : "(WRONG)");
+    if (pondered <= 0) status = 1;
+  }
+
+  // the solver takes over wherever the depth reaches the end
+  engine_set_endgame_empties(BENCH_SOLVE_EMPTIES);
+  uint64_t totalNodes = 0;
+  uint64_t totalTime = 0;
+  for (size_t i = 0; i < sizeof(BOARDS) / sizeof(BOARDS[0]); ++i) {
+    const int empty = BOARD_SIZE * BOARD_SIZE - popcount(BOARDS[i][0] | BOARDS[i][1]);
+    const bool solved = empty <= BENCH_SOLVE_EMPTIES;
+    if (solved ? !solve : depth == 0) continue;
+
+    Analysis analysis = {.player = BOARDS[i][0],
+        .opponent = BOARDS[i][1],
+        .depth = solved ? empty : depth};
+    engine_search(&analysis);
+    totalNodes += analysis.nodes;
+    totalTime += analysis.time;
+
+    printf("board %2zu: %2i empty, %-6s depth %2i move %c%i score %6i %12llu nodes %9.3fs %6.2f "
+           "Mnps\n",
+        i,
+        empty,
+        solved ? "solved" : "search",
+        analysis.depth,
+        'a' + analysis.move % BOARD_SIZE,
+        analysis.move / BOARD_SIZE + 1,
+        analysis.score,
+        (unsigned long long)analysis.nodes,
+        analysis.time / 1e6,
+        analysis.time > 0 ? (double)analysis.nodes / analysis.time : 0.0);
+  }
+  if (totalTime > 0) {
+    printf("search: %llu nodes %.3fs %.2f Mnps (depth %i)\n",
+        (unsigned long long)totalNodes,
+        totalTime / 1e6,
+        (double)totalNodes / totalTime,
+        depth);
+  }
+  return status;
+}
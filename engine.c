@@ -0,0 +1,3970 @@
+/**
+ * Hammer: A Reversi Minimax AI
+ * Copyright (C) 2024 marcus8448
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "engine.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <Windows.h>
+#else
+#include <cpuid.h>
+#include <fcntl.h>
+#include <immintrin.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define MOVE_CUTOFF 15000000
+
+#ifdef DEBUG_MODE
+#define DEBUG_LOG
+#undef NDEBUG
+#include <assert.h>
+#else
+#define puts(s) ;
+#define printf(s, ...) ;
+#define putchar(c) ;
+#define fflush(f) ;
+#endif
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#ifdef _MSC_VER
+#define popcount(x) ((int)__popcnt64(x))
+#define ctz(x) ((int)_tzcnt_u64(x))
+#define bswap(x) _byteswap_uint64(x)
+#else
+#define popcount(x) __builtin_popcountll(x)
+#define ctz(x) __builtin_ctzll(x)
+#define bswap(x) __builtin_bswap64(x)
+#endif
+#include <limits.h>
+#include <stdatomic.h>
+
+static void print_board(uint64_t player, uint64_t opponent) {
+  uint8_t index = 0;
+  for (uint8_t y = 0; y < BOARD_SIZE; y++) {
+    for (uint8_t x = 0; x < BOARD_SIZE; x++, index++) {
+      printf("%c ", ((player >> index) & 0b1) ? 'X' : opponent >> index & 0b1 ? 'O' : '-');
+    }
+    putchar('\n');
+  }
+  assert(!(player & opponent));
+}
+
+// lenStates of a child that has never been searched (its value is not set)
+#define STATE_PENDING (-2)
+
+/**
+ * \brief a node of the search tree
+ * \note the tiles are not stored, they are recalculated from the parent's tiles while descending
+ */
+typedef struct BoardState {
+  // offset of the first child in the active arena
+  uint32_t nextStates;
+  // the change in evaluation for the player that made the move
+  int16_t value;
+  // the best score the player to move can reach, relative to the evaluation of this board
+  int16_t worstBranch;
+  // index of the placed tile
+  uint8_t index;
+  int8_t lenStates;
+} BoardState;
+
+static int8_t BOARD_VALUES[BOARD_SIZE * BOARD_SIZE] = {
+    1,   -30,  1,   -1,   -1,    1,   -30,  1,
+    -30, -30,  0,    0,    0,    0,   -30,  -30,
+    1,   0,    0,    0,    0,    0,   0,    1,
+    -1,  0,    0,    0,    0,    0,   0,   -1,
+    -1,  0,    0,    0,    0,    0,   0,   -1,
+    1,   0,    0,    0,    0,    0,   0,    1,
+    -30, -30,  0,    0,    0,    0,   -30,  -30,
+    1,   -30,  1,   -1,   -1,    1,   -30,  1,
+};
+
+/**
+ * \brief bump allocator for the child arrays of the search tree
+ * \note two arenas are used: when the head advances the kept subtree is copied into the other
+ * arena, and everything left in the old one is dropped at once
+ */
+typedef struct Arena {
+  BoardState *base;
+  // the number of board states the arena holds
+  size_t size;
+  atomic_size_t top;
+  // changed (to a value no other arena had) whenever the arena is dropped, invalidating the chunks
+  // threads claimed in it
+  atomic_uint generation;
+} Arena;
+
+typedef struct TaskGroup {
+  atomic_int pending;
+  // set if the waiting thread is not a worker (and sleeps instead of helping)
+  bool external;
+} TaskGroup;
+
+typedef struct Task {
+  void (*run)(void *args);
+  void *args;
+  TaskGroup *group;
+  // the engine the task searches for, the one of the thread that spawned it
+  Engine *engine;
+  // next task in the shared queue
+  struct Task *next;
+} Task;
+
+// plies below the head the tree keeps by default
+#define TREE_DEFAULT_PLIES 4
+
+/**
+ * \brief the state of one game: its search tree, counters and settings
+ * \note the threads, transposition table, opening book and evaluations are shared by every engine
+ */
+struct Engine {
+  // the board after the last move, the root of the tree
+  BoardState head;
+  // tiles of the player that made the move at the head, and of the player to move (us)
+  uint64_t headPlayer;
+  uint64_t headOpponent;
+  // tiles on the board after our move
+  int placedTiles;
+  // plies the current iteration searches
+  int maxDepth;
+  // boards deeper than this below the head are searched without being added to the tree (see
+  // search_state_stack), 0 keeps every ply
+  int treePlies;
+  // how the search of the head is spread between the threads, SEARCH_SPLIT or SEARCH_LAZY
+  int searchMode;
+  // empty squares left when the endgame solver takes over
+  int endgameEmpties;
+  // how far past the search window a shallow search has to be for ProbCut to skip the deep one,
+  // by phase (0 disables ProbCut)
+  int probcutMargins[PROBCUT_PHASES];
+  // set to keep searching the head on the opponent's time
+  bool ponderEnabled;
+  TaskGroup ponderGroup;
+  Task ponderTask;
+  // the deepest iteration the last ponder completed
+  int ponderDepth;
+  // the evaluation the tree is searched with
+  const Evaluator *evaluator;
+  // the deepest iteration engine_move searches, 0 for no limit
+  int depthLimit;
+  // set to print how long each move took
+  bool moveLog;
+
+  // nodes visited this move, by all threads
+  atomic_uint_fast64_t visited;
+  // cutoffs, ProbCut prunes and transposition table probes / hits of the tree search this move, by
+  // all threads
+  atomic_uint_fast64_t cutoffs;
+  atomic_uint_fast64_t probcuts;
+  atomic_uint_fast64_t tableProbes;
+  atomic_uint_fast64_t tableHits;
+  // nodes of lazy smp helpers, which are kept apart as they can't run the tree out of space
+  atomic_uint_fast64_t helperVisited;
+  // what the last search did, see engine_stats
+  EngineStats searchStats;
+  // set when the current iteration has to be abandoned (out of time, nodes or space), every
+  // thread searching stops as soon as it sees it
+  atomic_bool searchAborted;
+  // time (ms) the current iteration has to be abandoned at
+  uint64_t searchDeadline;
+  // nodes the current iteration can visit, MOVE_CUTOFF unless nothing is stored
+  uint64_t searchNodeLimit;
+  // set once the tree search of a lazy smp iteration is done, so its helpers stop
+  atomic_bool lazyStop;
+  // the tasks of the lazy smp helpers, one per worker but the one searching the tree
+  struct LazyHelper *lazyHelpers;
+
+  // the tree's child arrays, the active one and the one the kept subtree is copied into
+  Arena arenas[2];
+  int activeArena;
+
+  // the engine created before this one, see engines
+  Engine *next;
+};
+
+// the engine of every call that doesn't select another one (set up by engine_init)
+static Engine defaultEngine;
+// the engine the current thread searches for: the one it selected, or the one of its task
+static thread_local Engine *engine = &defaultEngine;
+// every engine, the default one and those from engine_create (guarded by enginesLock)
+static Engine *engines = &defaultEngine;
+static mtx_t enginesLock;
+
+// nodes visited by the current thread that have not been added to visited yet
+static thread_local uint32_t localVisited = 0;
+// nodes the current thread has added to visited, ever
+static thread_local uint64_t flushedVisited = 0;
+// cutoffs, ProbCut prunes and transposition table probes / hits by the current thread since it
+// last added them (with its nodes)
+static thread_local uint32_t localCutoffs = 0;
+static thread_local uint32_t localProbcuts = 0;
+static thread_local uint32_t localTableProbes = 0;
+static thread_local uint32_t localTableHits = 0;
+
+// how many nodes a thread visits before adding them to visited and checking the time
+#define NODE_BATCH 1024
+
+/**
+ * \return microseconds since some point in the past, never goes backwards (monotonic)
+ */
+static uint64_t time_us(void) {
+#ifdef _MSC_VER
+  static LARGE_INTEGER frequency = {.QuadPart = 0};
+  if (frequency.QuadPart == 0) {
+    QueryPerformanceFrequency(&frequency);
+  }
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  const uint64_t ticks = (uint64_t)counter.QuadPart;
+  const uint64_t perSecond = (uint64_t)frequency.QuadPart;
+  return ticks / perSecond * 1000000 + ticks % perSecond * 1000000 / perSecond;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+#endif
+}
+
+static uint64_t time_ms(void) {
+  return time_us() / 1000;
+}
+
+static inline bool search_aborted(void) {
+  return atomic_load_explicit(&engine->searchAborted, memory_order_relaxed);
+}
+
+static inline void search_abort(void) {
+  atomic_store_explicit(&engine->searchAborted, true, memory_order_relaxed);
+}
+
+/**
+ * \brief adds the current thread's cutoffs, ProbCut prunes and table lookups to the engine's
+ */
+static void search_flush_counts(void) {
+  atomic_fetch_add_explicit(&engine->cutoffs, localCutoffs, memory_order_relaxed);
+  atomic_fetch_add_explicit(&engine->probcuts, localProbcuts, memory_order_relaxed);
+  atomic_fetch_add_explicit(&engine->tableProbes, localTableProbes, memory_order_relaxed);
+  atomic_fetch_add_explicit(&engine->tableHits, localTableHits, memory_order_relaxed);
+  localCutoffs = 0;
+  localProbcuts = 0;
+  localTableProbes = 0;
+  localTableHits = 0;
+}
+
+/**
+ * \brief adds the current thread's nodes to visited, stopping the search if out of nodes or time
+ */
+static void search_flush_nodes(void) {
+  const uint64_t total =
+      atomic_fetch_add_explicit(&engine->visited, localVisited, memory_order_relaxed) +
+      localVisited;
+  flushedVisited += localVisited;
+  localVisited = 0;
+  search_flush_counts();
+
+  if (total > engine->searchNodeLimit || time_ms() >= engine->searchDeadline) {
+    search_abort();
+  }
+}
+
+/**
+ * \brief counts visited nodes
+ * \param count the number of nodes visited
+ * \return true if the current iteration was abandoned
+ */
+static inline bool search_count_nodes(const int count) {
+  localVisited += count;
+  if (localVisited >= NODE_BATCH) {
+    search_flush_nodes();
+  }
+  return search_aborted();
+}
+
+// board (byte format)
+// << 63 62 61 60 59 58 57 56
+//    55 54 53 52 51 50 49 48
+//    47 46 45 44 43 42 41 40
+//    39 38 37 36 35 34 33 32
+//    31 30 29 28 27 26 25 24
+//    23 22 21 20 19 18 17 16
+//    15 14 13 12 11 10 09 08
+//    07 06 05 04 03 02 01 00 >>
+
+// every square except the left and right columns (stops horizontal/diagonal shifts from wrapping)
+#define MASK_INNER_COLUMNS 0x7E7E7E7E7E7E7E7EULL
+#define MASK_COLUMN_A 0x0101010101010101ULL
+#define MASK_COLUMN_H 0x8080808080808080ULL
+
+// kernels only use instructions beyond the baseline in functions compiled for them
+#ifdef _MSC_VER
+#define TARGET(features)
+#else
+#define TARGET(features) __attribute__((target(features)))
+#endif
+
+/**
+ * \brief calculates every legal move for a player at once, without vector instructions
+ * \see generate_move_mask
+ */
+static uint64_t move_mask_generic(const uint64_t player, const uint64_t opponent) {
+  const uint64_t empty = ~(player | opponent);
+  const uint64_t masks[4] = {opponent & MASK_INNER_COLUMNS,
+      opponent,
+      opponent & MASK_INNER_COLUMNS,
+      opponent & MASK_INNER_COLUMNS};
+  const uint8_t shifts[4] = {1, BOARD_SIZE, BOARD_SIZE - 1, BOARD_SIZE + 1};
+  uint64_t moves = 0;
+
+  for (int d = 0; d < 4; ++d) {
+    const uint64_t mask = masks[d];
+    const uint8_t shift = shifts[d];
+
+    uint64_t flipL = mask & (player << shift);
+    uint64_t flipR = mask & (player >> shift);
+    flipL |= mask & (flipL << shift);
+    flipR |= mask & (flipR >> shift);
+
+    // pairs of adjacent opponent tiles, lets the fill advance two tiles per step
+    const uint64_t preL = mask & (mask << shift);
+    const uint64_t preR = preL >> shift;
+    flipL |= preL & (flipL << (shift * 2));
+    flipR |= preR & (flipR >> (shift * 2));
+    flipL |= preL & (flipL << (shift * 2));
+    flipR |= preR & (flipR >> (shift * 2));
+
+    // the tile after the end of each run is the move
+    moves |= (flipL << shift) | (flipR >> shift);
+  }
+  return moves & empty;
+}
+
+/**
+ * \brief calculates every legal move for a player at once, with the four directions (both ways) in
+ * the lanes of avx2 vectors
+ * \see generate_move_mask
+ */
+TARGET("avx2")
+static uint64_t move_mask_avx2(const uint64_t player, const uint64_t opponent) {
+  const uint64_t empty = ~(player | opponent);
+  // lanes: right/left (1), up/down (8), diagonals (7, 9) - shifted both ways, so 8 directions
+  const __m256i shift = _mm256_set_epi64x(9, 7, BOARD_SIZE, 1);
+  const __m256i shift2 = _mm256_add_epi64(shift, shift);
+  const __m256i pp = _mm256_set1_epi64x((int64_t)player);
+  const __m256i mask = _mm256_and_si256(_mm256_set1_epi64x((int64_t)opponent),
+      _mm256_set_epi64x(MASK_INNER_COLUMNS, MASK_INNER_COLUMNS, -1, MASK_INNER_COLUMNS));
+
+  __m256i flipL = _mm256_and_si256(mask, _mm256_sllv_epi64(pp, shift));
+  __m256i flipR = _mm256_and_si256(mask, _mm256_srlv_epi64(pp, shift));
+  flipL = _mm256_or_si256(flipL, _mm256_and_si256(mask, _mm256_sllv_epi64(flipL, shift)));
+  flipR = _mm256_or_si256(flipR, _mm256_and_si256(mask, _mm256_srlv_epi64(flipR, shift)));
+
+  // pairs of adjacent opponent tiles, lets the fill advance two tiles per step
+  const __m256i preL = _mm256_and_si256(mask, _mm256_sllv_epi64(mask, shift));
+  const __m256i preR = _mm256_srlv_epi64(preL, shift);
+  flipL = _mm256_or_si256(flipL, _mm256_and_si256(preL, _mm256_sllv_epi64(flipL, shift2)));
+  flipR = _mm256_or_si256(flipR, _mm256_and_si256(preR, _mm256_srlv_epi64(flipR, shift2)));
+  flipL = _mm256_or_si256(flipL, _mm256_and_si256(preL, _mm256_sllv_epi64(flipL, shift2)));
+  flipR = _mm256_or_si256(flipR, _mm256_and_si256(preR, _mm256_srlv_epi64(flipR, shift2)));
+
+  // the tile after the end of each run is the move
+  const __m256i moves =
+      _mm256_or_si256(_mm256_sllv_epi64(flipL, shift), _mm256_srlv_epi64(flipR, shift));
+  const __m128i half =
+      _mm_or_si128(_mm256_castsi256_si128(moves), _mm256_extracti128_si256(moves, 1));
+  return ((uint64_t)_mm_cvtsi128_si64(half) | (uint64_t)_mm_extract_epi64(half, 1)) & empty;
+}
+
+/**
+ * \brief calculates the tiles flipped by placing a tile, without vector instructions
+ * \see generate_flip_mask
+ */
+static uint64_t flip_mask_generic(
+    const uint64_t player, const uint64_t opponent, const uint8_t index, int *directions) {
+  const uint64_t placed = 1ULL << index;
+  const uint64_t masks[4] = {opponent & MASK_INNER_COLUMNS,
+      opponent,
+      opponent & MASK_INNER_COLUMNS,
+      opponent & MASK_INNER_COLUMNS};
+  const uint8_t shifts[4] = {1, BOARD_SIZE, BOARD_SIZE - 1, BOARD_SIZE + 1};
+  uint64_t flips = 0;
+  *directions = 0;
+
+  for (int d = 0; d < 4; ++d) {
+    const uint64_t mask = masks[d];
+    const uint8_t shift = shifts[d];
+
+    // walk out from the placed tile over contiguous opponent tiles
+    uint64_t flipL = mask & (placed << shift);
+    uint64_t flipR = mask & (placed >> shift);
+    for (int i = 0; i < BOARD_SIZE - 3; ++i) {
+      flipL |= mask & (flipL << shift);
+      flipR |= mask & (flipR >> shift);
+    }
+
+    // only keep runs that are closed off by one of the player's tiles
+    if (flipL && (flipL << shift) & player) {
+      flips |= flipL;
+      ++*directions;
+    }
+    if (flipR && (flipR >> shift) & player) {
+      flips |= flipR;
+      ++*directions;
+    }
+  }
+  return flips;
+}
+
+/**
+ * \brief calculates the tiles flipped by placing a tile, walking every direction at once in the
+ * lanes of avx2 vectors
+ * \see generate_flip_mask
+ */
+TARGET("avx2")
+static uint64_t flip_mask_avx2(
+    const uint64_t player, const uint64_t opponent, const uint8_t index, int *directions) {
+  const uint64_t placed = 1ULL << index;
+  const __m256i shift = _mm256_set_epi64x(9, 7, BOARD_SIZE, 1);
+  const __m256i pp = _mm256_set1_epi64x((int64_t)player);
+  const __m256i tile = _mm256_set1_epi64x((int64_t)placed);
+  const __m256i mask = _mm256_and_si256(_mm256_set1_epi64x((int64_t)opponent),
+      _mm256_set_epi64x(MASK_INNER_COLUMNS, MASK_INNER_COLUMNS, -1, MASK_INNER_COLUMNS));
+
+  // walk out from the placed tile over contiguous opponent tiles
+  __m256i flipL = _mm256_and_si256(mask, _mm256_sllv_epi64(tile, shift));
+  __m256i flipR = _mm256_and_si256(mask, _mm256_srlv_epi64(tile, shift));
+  for (int i = 0; i < BOARD_SIZE - 3; ++i) {
+    flipL = _mm256_or_si256(flipL, _mm256_and_si256(mask, _mm256_sllv_epi64(flipL, shift)));
+    flipR = _mm256_or_si256(flipR, _mm256_and_si256(mask, _mm256_srlv_epi64(flipR, shift)));
+  }
+
+  // only keep runs that are closed off by one of the player's tiles
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i openL =
+      _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_sllv_epi64(flipL, shift), pp), zero);
+  const __m256i openR =
+      _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_srlv_epi64(flipR, shift), pp), zero);
+  flipL = _mm256_andnot_si256(openL, flipL);
+  flipR = _mm256_andnot_si256(openR, flipR);
+
+  const int emptyL = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(flipL, zero)));
+  const int emptyR = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(flipR, zero)));
+  *directions = 8 - popcount(emptyL) - popcount(emptyR);
+
+  const __m256i flips = _mm256_or_si256(flipL, flipR);
+  const __m128i half =
+      _mm_or_si128(_mm256_castsi256_si128(flips), _mm256_extracti128_si256(flips, 1));
+  return (uint64_t)_mm_cvtsi128_si64(half) | (uint64_t)_mm_extract_epi64(half, 1);
+}
+
+// the row, column, diagonal and anti-diagonal through each square
+static uint64_t LINES[BOARD_SIZE * BOARD_SIZE][4];
+// where each square is in its lines, counting the line's tiles from the lowest
+static uint8_t LINE_POSITIONS[BOARD_SIZE * BOARD_SIZE][4];
+// by the position of the placed tile and the other player's tiles of a line: the tiles just past
+// each run of the other player's tiles next to it (which flip the run if they are the player's)
+static uint8_t OUTFLANKS[BOARD_SIZE][256];
+// by the position of the placed tile and the tiles of a line that outflank it: the flipped tiles
+static uint8_t LINE_FLIPS[BOARD_SIZE][256];
+
+/**
+ * \brief builds the tables of the bmi2 flip kernel
+ */
+static void line_tables_init(void) {
+  // one step along each line: x, y
+  const int steps[4][2] = {{1, 0}, {0, 1}, {1, 1}, {-1, 1}};
+  for (int index = 0; index < BOARD_SIZE * BOARD_SIZE; ++index) {
+    for (int line = 0; line < 4; ++line) {
+      uint64_t mask = 0;
+      for (int way = -1; way <= 1; way += 2) {
+        int x = index % BOARD_SIZE;
+        int y = index / BOARD_SIZE;
+        for (; x >= 0 && x < BOARD_SIZE && y >= 0 && y < BOARD_SIZE;
+             x += steps[line][0] * way, y += steps[line][1] * way) {
+          mask |= 1ULL << (y * BOARD_SIZE + x);
+        }
+      }
+      LINES[index][line] = mask;
+      LINE_POSITIONS[index][line] = (uint8_t)popcount(mask & ((1ULL << index) - 1));
+    }
+  }
+
+  for (int position = 0; position < BOARD_SIZE; ++position) {
+    for (int bits = 0; bits < 256; ++bits) {
+      uint8_t outflanks = 0;
+      uint8_t flips = 0;
+      for (int way = -1; way <= 1; way += 2) {
+        int i = position + way;
+        while (i >= 0 && i < BOARD_SIZE && (bits >> i & 1)) {
+          i += way;
+        }
+        // past at least one of the other player's tiles
+        if (i != position + way && i >= 0 && i < BOARD_SIZE) {
+          outflanks |= 1 << i;
+        }
+        // bits holds the outflanking tiles here, at most one each way
+        for (int j = position + way; j >= 0 && j < BOARD_SIZE; j += way) {
+          if (bits >> j & 1) {
+            for (int k = position + way; k != j; k += way) {
+              flips |= 1 << k;
+            }
+            break;
+          }
+        }
+      }
+      OUTFLANKS[position][bits] = outflanks;
+      LINE_FLIPS[position][bits] = flips;
+    }
+  }
+}
+
+/**
+ * \brief calculates the tiles flipped by placing a tile, looking up each line through it: pext
+ * packs the line's tiles into a byte and pdep puts the flipped ones back
+ * \see generate_flip_mask
+ * \note pext and pdep are microcoded (slow) before zen 3 on amd cpus
+ */
+TARGET("bmi2")
+static uint64_t flip_mask_bmi2(
+    const uint64_t player, const uint64_t opponent, const uint8_t index, int *directions) {
+  uint64_t flips = 0;
+  *directions = 0;
+  for (int line = 0; line < 4; ++line) {
+    const uint64_t mask = LINES[index][line];
+    const uint8_t position = LINE_POSITIONS[index][line];
+    const uint8_t outflanks =
+        OUTFLANKS[position][_pext_u64(opponent, mask)] & (uint8_t)_pext_u64(player, mask);
+    // only one outflanking tile each way
+    *directions += popcount(outflanks);
+    flips |= _pdep_u64(LINE_FLIPS[position][outflanks], mask);
+  }
+  return flips;
+}
+
+/**
+ * \brief a set of move generation kernels, they give the same results
+ */
+typedef struct Kernel {
+  const char *name;
+  uint64_t (*moveMask)(uint64_t player, uint64_t opponent);
+  uint64_t (*flipMask)(uint64_t player, uint64_t opponent, uint8_t index, int *directions);
+} Kernel;
+
+#define KERNEL_GENERIC 0
+#define KERNEL_AVX2 1
+#define KERNEL_BMI2 2
+
+static const Kernel KERNELS[] = {
+    {"generic", move_mask_generic, flip_mask_generic},
+    {"avx2", move_mask_avx2, flip_mask_avx2},
+    // there are no cpus with bmi2 but without avx2
+    {"bmi2", move_mask_avx2, flip_mask_bmi2},
+};
+
+#ifdef HAMMER_NATIVE
+// built for one cpu only, so the kernels are picked when compiling (and can be inlined)
+#if defined(__BMI2__) && !defined(__znver1__) && !defined(__znver2__) && !defined(__bdver4__)
+#define KERNEL_NATIVE KERNEL_BMI2
+#elif defined(__AVX2__)
+#define KERNEL_NATIVE KERNEL_AVX2
+#else
+#define KERNEL_NATIVE KERNEL_GENERIC
+#endif
+static const Kernel *kernel = &KERNELS[KERNEL_NATIVE];
+#else
+// the kernels in use, see kernel_best
+static const Kernel *kernel = &KERNELS[KERNEL_GENERIC];
+
+/**
+ * \brief what the cpu (and the operating system) can run
+ */
+typedef struct CpuFeatures {
+  bool avx2;
+  bool bmi2;
+  // set if pext and pdep are microcoded
+  bool slowPext;
+} CpuFeatures;
+
+/**
+ * \brief runs cpuid
+ * \param registers set to eax, ebx, ecx and edx
+ */
+static void cpuid(const unsigned int leaf, const unsigned int subleaf, unsigned int registers[4]) {
+#ifdef _MSC_VER
+  __cpuidex((int *)registers, (int)leaf, (int)subleaf);
+#else
+  __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+/**
+ * \brief finds out what the cpu can run with cpuid
+ * \note avx2 also needs the operating system to save the ymm registers
+ */
+static CpuFeatures cpu_features(void) {
+  CpuFeatures features = {.avx2 = false, .bmi2 = false, .slowPext = false};
+  unsigned int registers[4];
+  cpuid(0, 0, registers);
+  const unsigned int leaves = registers[0];
+  // "AuthenticAMD", in ebx, edx, ecx
+  const bool amd = registers[1] == 0x68747541 && registers[3] == 0x69746E65 &&
+                   registers[2] == 0x444D4163;
+  if (leaves < 7) return features;
+
+  cpuid(1, 0, registers);
+  unsigned int family = registers[0] >> 8 & 0xF;
+  if (family == 0xF) family += registers[0] >> 20 & 0xFF;
+  const bool osxsave = registers[2] >> 27 & 1;
+  const bool avx = registers[2] >> 28 & 1;
+  if (!osxsave || !avx) return features;
+
+#ifdef _MSC_VER
+  const uint64_t xcr0 = _xgetbv(0);
+#else
+  unsigned int low, high;
+  __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+  const uint64_t xcr0 = (uint64_t)high << 32 | low;
+#endif
+  // xmm and ymm state
+  if ((xcr0 & 6) != 6) return features;
+
+  cpuid(7, 0, registers);
+  features.avx2 = registers[1] >> 5 & 1;
+  features.bmi2 = features.avx2 && (registers[1] >> 8 & 1);
+  // zen 2 and older (family 17h and below)
+  features.slowPext = amd && family < 0x19;
+  return features;
+}
+
+/**
+ * \return whether the cpu can run a kernel
+ */
+static bool kernel_supported(const CpuFeatures *features, const int id) {
+  return id == KERNEL_GENERIC || (id == KERNEL_AVX2 && features->avx2) ||
+         (id == KERNEL_BMI2 && features->bmi2);
+}
+
+/**
+ * \return the fastest kernel the cpu runs well
+ */
+static int kernel_best(const CpuFeatures *features) {
+  if (features->bmi2 && !features->slowPext) return KERNEL_BMI2;
+  return features->avx2 ? KERNEL_AVX2 : KERNEL_GENERIC;
+}
+#endif
+
+/**
+ * \brief calculates every legal move for a player at once
+ * \param player the tiles of the player to move
+ * \param opponent the tiles of the other player
+ * \return a bitboard with a 1 on every empty tile that flips at least one opponent tile
+ * \note each direction is flooded from the player's tiles through contiguous opponent tiles
+ * (kogge-stone style, so 4 shifts cover the 6 tiles a line can flip)
+ */
+static inline uint64_t generate_move_mask(const uint64_t player, const uint64_t opponent) {
+#if defined(HAMMER_NATIVE) && KERNEL_NATIVE != KERNEL_GENERIC
+  return move_mask_avx2(player, opponent);
+#elif defined(HAMMER_NATIVE)
+  return move_mask_generic(player, opponent);
+#else
+  return kernel->moveMask(player, opponent);
+#endif
+}
+
+/**
+ * \brief calculates the tiles flipped by placing a tile
+ * \param player the tiles of the player placing the tile
+ * \param opponent the tiles of the other player
+ * \param index the index of the tile being placed (must be empty, illegal moves flip nothing)
+ * \param directions set to the number of directions at least one tile was flipped in
+ * \return a bitboard of every opponent tile that is flipped
+ */
+static inline uint64_t generate_flip_mask(
+    const uint64_t player, const uint64_t opponent, const uint8_t index, int *directions) {
+#if defined(HAMMER_NATIVE) && KERNEL_NATIVE == KERNEL_BMI2
+  return flip_mask_bmi2(player, opponent, index, directions);
+#elif defined(HAMMER_NATIVE) && KERNEL_NATIVE == KERNEL_AVX2
+  return flip_mask_avx2(player, opponent, index, directions);
+#elif defined(HAMMER_NATIVE)
+  return flip_mask_generic(player, opponent, index, directions);
+#else
+  return kernel->flipMask(player, opponent, index, directions);
+#endif
+}
+
+// the most legal moves any position can have
+#define MAX_MOVES (BOARD_SIZE * BOARD_SIZE)
+
+typedef struct MoveList {
+  uint64_t mask;
+  int8_t count;
+  uint8_t index[MAX_MOVES];
+  int8_t key[MAX_MOVES];
+} MoveList;
+
+/**
+ * \brief finds every legal move without applying any of them
+ * \param player the tiles of the player to move
+ * \param opponent the tiles of the other player
+ * \param list filled with the move mask and each move's index, best ordering key first
+ */
+static void generate_moves(const uint64_t player, const uint64_t opponent, MoveList *list) {
+  list->mask = generate_move_mask(player, opponent);
+  list->count = 0;
+
+  for (uint64_t moves = list->mask; moves; moves &= moves - 1) {
+    const uint8_t index = (uint8_t)ctz(moves);
+    const int8_t key = BOARD_VALUES[index];
+
+    // insertion sort, there are rarely more than ~15 moves
+    int8_t i = list->count++;
+    for (; i > 0 && list->key[i - 1] < key; --i) {
+      list->index[i] = list->index[i - 1];
+      list->key[i] = list->key[i - 1];
+    }
+    list->index[i] = index;
+    list->key[i] = key;
+  }
+}
+
+// number of configurations of a line of 8 tiles (empty, player or opponent each)
+#define PATTERN_SIZE 6561
+// default evaluation weights, see EvalWeights
+#define EVAL_CORNER 40
+#define EVAL_STABLE 10
+#define EVAL_C_SQUARE 12
+#define EVAL_X_SQUARE 25
+#define EVAL_EDGE 2
+#define EVAL_MOBILITY 8
+#define EVAL_POTENTIAL_MOBILITY 2
+#define EVAL_FRONTIER 2
+// score of a won game, before the disc differential is added
+#define WIN_SCORE (INT16_MAX / 8)
+
+// the patterns are the 4 edges and the 2 diagonals, each read from one corner to the opposite one
+#define PATTERNS 6
+static const uint64_t DIAGONALS[2] = {0x8040201008040201ULL, 0x0102040810204080ULL};
+// multiplying column a by this packs it into the top byte, from row 1 up
+#define COLUMN_PACK 0x0102040810204080ULL
+// multiplying a diagonal by this packs it into the top byte (the anti-diagonal from a8 to h1)
+#define DIAGONAL_PACK 0x0101010101010101ULL
+
+// the bits of a byte as a base 3 number, a line's index is BASE3[player] + 2 * BASE3[opponent]
+static uint16_t BASE3[256];
+
+struct Evaluator {
+  // the value of every configuration of an edge / diagonal for the player
+  int16_t edges[PATTERN_SIZE];
+  int16_t diagonals[PATTERN_SIZE];
+  int mobility;
+  int potentialMobility;
+  int frontier;
+  // mixed into the hashes of boards searched with this evaluation, so its scores are not mixed up
+  // with other evaluations' in the transposition table (0 for the default one)
+  uint64_t hashKey;
+};
+
+// the evaluation of the game tree
+static Evaluator defaultEvaluator;
+
+/**
+ * \brief scores an edge for one side
+ * \param weights the evaluation weights
+ * \param line the tiles of the edge: 0 empty, 1 own, 2 the other side's
+ * \param own the value of the side's tiles
+ */
+static int score_edge(const EvalWeights *weights, const uint8_t *line, const uint8_t own) {
+  int score = 0;
+  bool full = true;
+  for (int i = 0; i < BOARD_SIZE; ++i) {
+    full &= line[i] != 0;
+  }
+
+  for (int end = 0; end < 2; ++end) {
+    const int corner = end ? BOARD_SIZE - 1 : 0;
+    const int step = end ? -1 : 1;
+    if (line[corner] == own) {
+      // both edges of a corner count it
+      score += weights->corner / 2;
+      for (int i = corner + step; i >= 0 && i < BOARD_SIZE && line[i] == own; i += step) {
+        score += weights->stable;
+      }
+    } else if (line[corner] == 0 && line[corner + step] == own) {
+      score -= weights->cSquare;
+    }
+  }
+
+  for (int i = 0; i < BOARD_SIZE; ++i) {
+    if (line[i] != own) continue;
+    // a full edge can't change anymore
+    if (full) {
+      score += weights->stable;
+    } else if (i > 1 && i < BOARD_SIZE - 2) {
+      score += weights->edge;
+    }
+  }
+  return score;
+}
+
+/**
+ * \brief scores a diagonal for one side
+ * \see score_edge
+ */
+static int score_diagonal(const EvalWeights *weights, const uint8_t *line, const uint8_t own) {
+  int score = 0;
+  if (line[0] == 0 && line[1] == own) score -= weights->xSquare;
+  if (line[BOARD_SIZE - 1] == 0 && line[BOARD_SIZE - 2] == own) score -= weights->xSquare;
+  return score;
+}
+
+/**
+ * \brief builds the tables of an evaluation
+ */
+static void evaluator_build(Evaluator *evaluator, const EvalWeights *weights) {
+  for (int index = 0; index < PATTERN_SIZE; ++index) {
+    uint8_t line[BOARD_SIZE];
+    for (int i = 0, rest = index; i < BOARD_SIZE; ++i, rest /= 3) {
+      line[i] = (uint8_t)(rest % 3);
+    }
+    evaluator->edges[index] =
+        (int16_t)(score_edge(weights, line, 1) - score_edge(weights, line, 2));
+    evaluator->diagonals[index] =
+        (int16_t)(score_diagonal(weights, line, 1) - score_diagonal(weights, line, 2));
+  }
+  evaluator->mobility = weights->mobility;
+  evaluator->potentialMobility = weights->potentialMobility;
+  evaluator->frontier = weights->frontier;
+  evaluator->hashKey = 0;
+}
+
+static void eval_init(void) {
+  for (int bits = 0; bits < 256; ++bits) {
+    BASE3[bits] = 0;
+    for (int i = BOARD_SIZE - 1; i >= 0; --i) {
+      BASE3[bits] = (uint16_t)(BASE3[bits] * 3 + ((bits >> i) & 1));
+    }
+  }
+
+  EvalWeights weights;
+  engine_default_weights(&weights);
+  evaluator_build(&defaultEvaluator, &weights);
+}
+
+/**
+ * \brief packs the tiles of each pattern into a byte
+ * \param lines set to rows 1 and 8, columns a and h, then the diagonal and the anti-diagonal
+ * \note the multiplications never carry, so this needs no pext
+ */
+static inline void pattern_lines(const uint64_t board, uint8_t lines[PATTERNS]) {
+  lines[0] = (uint8_t)board;
+  lines[1] = (uint8_t)(board >> 56);
+  lines[2] = (uint8_t)(((board & MASK_COLUMN_A) * COLUMN_PACK) >> 56);
+  lines[3] = (uint8_t)(((board >> (BOARD_SIZE - 1) & MASK_COLUMN_A) * COLUMN_PACK) >> 56);
+  lines[4] = (uint8_t)(((board & DIAGONALS[0]) * DIAGONAL_PACK) >> 56);
+  lines[5] = (uint8_t)(((board & DIAGONALS[1]) * DIAGONAL_PACK) >> 56);
+}
+
+/**
+ * \return the squares next to any of the tiles (and the tiles)
+ */
+static inline uint64_t neighbours(const uint64_t tiles) {
+  const uint64_t row = tiles | (tiles << 1 & ~MASK_COLUMN_A) | (tiles >> 1 & ~MASK_COLUMN_H);
+  return row | row << BOARD_SIZE | row >> BOARD_SIZE;
+}
+
+/**
+ * \brief evaluates a board
+ * \param evaluator the evaluation to use
+ * \param player the tiles of the side the score is for
+ * \param opponent the tiles of the other side
+ * \return the score of the board for the player, the other side's is the negation
+ */
+static int evaluate_with(
+    const Evaluator *evaluator, const uint64_t player, const uint64_t opponent) {
+  const uint64_t empty = ~(player | opponent);
+  const uint64_t open = neighbours(empty);
+  int score = evaluator->mobility * (popcount(generate_move_mask(player, opponent)) -
+                                        popcount(generate_move_mask(opponent, player)));
+  score += evaluator->potentialMobility * (popcount(empty & neighbours(opponent)) -
+                                              popcount(empty & neighbours(player)));
+  score -= evaluator->frontier * (popcount(player & open) - popcount(opponent & open));
+
+  uint8_t own[PATTERNS];
+  uint8_t other[PATTERNS];
+  pattern_lines(player, own);
+  pattern_lines(opponent, other);
+  for (int i = 0; i < PATTERNS; ++i) {
+    const int16_t *values = i < 4 ? evaluator->edges : evaluator->diagonals;
+    score += values[BASE3[own[i]] + 2 * BASE3[other[i]]];
+  }
+  return score;
+}
+
+/**
+ * \brief evaluates a board with the evaluation of the current engine
+ * \see evaluate_with
+ */
+static inline int evaluate(const uint64_t player, const uint64_t opponent) {
+  return evaluate_with(engine->evaluator, player, opponent);
+}
+
+/**
+ * \return the disc differential of a finished game for the player, empty squares go to the winner
+ */
+static inline int final_score(const uint64_t player, const uint64_t opponent) {
+  const int diff = popcount(player) - popcount(opponent);
+  const int empties = BOARD_SIZE * BOARD_SIZE - popcount(player | opponent);
+  return diff > 0 ? diff + empties : (diff < 0 ? diff - empties : 0);
+}
+
+/**
+ * \brief applies a child's move, setting its value if it was pending
+ * \param player the tiles of the player that made the parent's move
+ * \param opponent the tiles of the player making the child's move
+ * \param child the child to apply the move of
+ * \param nextPlayer set to the tiles of the player that made the child's move
+ * \param nextOpponent set to the tiles of the other player
+ */
+static void apply_child_move(const uint64_t player,
+    const uint64_t opponent,
+    BoardState *child,
+    uint64_t *nextPlayer,
+    uint64_t *nextOpponent) {
+  int directions;
+  // swap
+  const uint64_t flips = generate_flip_mask(opponent, player, child->index, &directions);
+  assert(flips);
+
+  *nextPlayer = opponent | flips | 1ULL << child->index;
+  *nextOpponent = player & ~flips;
+  assert(!(*nextPlayer & *nextOpponent));
+
+  if (child->lenStates == STATE_PENDING) {
+    // how much the move improves the evaluation for the player making it, so the values along a
+    // line add up to the evaluation of where it ends (relative to where it started)
+    // pending children hold the evaluation of the parent, see generate_child_moves
+    child->value = (int16_t)(evaluate(*nextPlayer, *nextOpponent) - child->value);
+    child->lenStates = -1;
+
+    printf("^^^^^^ %i, %i ^^^^^^\n", child->index % BOARD_SIZE, child->index / BOARD_SIZE);
+    print_board(*nextPlayer, *nextOpponent);
+  }
+}
+
+// number of board states in each arena when the tree keeps every ply
+#define ARENA_NODES (MOVE_CUTOFF * 2)
+// number of board states a thread claims from an arena at once
+#define ARENA_CHUNK 1024
+// more moves than any board reached in a game has, bounding how wide the kept plies get
+#define ARENA_BRANCHING 34
+
+// the last generation given to an arena, so generations are never reused (even by an arena at the
+// address of a freed one)
+static atomic_uint arenaGeneration = 0;
+
+// the part of a chunk the current thread has not handed out yet
+static thread_local struct {
+  BoardState *next;
+  BoardState *end;
+  // the arena and its generation the chunk was claimed in
+  const Arena *arena;
+  unsigned int generation;
+} arenaCursor;
+
+/**
+ * \return the children of a board state
+ */
+static inline BoardState *node_children(const BoardState *state) {
+  return engine->arenas[engine->activeArena].base + state->nextStates;
+}
+
+/**
+ * \brief drops everything in an arena
+ */
+static void arena_drop(Arena *arena) {
+  atomic_store_explicit(&arena->top, 0, memory_order_relaxed);
+  atomic_store_explicit(&arena->generation,
+      atomic_fetch_add_explicit(&arenaGeneration, 1, memory_order_relaxed) + 1,
+      memory_order_release);
+}
+
+/**
+ * \return how many board states each arena of a tree that keeps a number of plies needs
+ * \param plies the plies the tree keeps, 0 for every ply
+ * \param threads the number of threads that can search the tree at once
+ */
+static size_t arena_nodes(const int plies, const int threads) {
+  if (plies == 0) return ARENA_NODES;
+
+  // every board of the kept plies, as wide as they can get
+  size_t nodes = 0;
+  size_t width = 1;
+  for (int ply = 1; ply <= plies && nodes < ARENA_NODES; ++ply) {
+    width *= ARENA_BRANCHING;
+    nodes += width;
+  }
+  // the end of a chunk too short for the next board's children is left unused, and each thread
+  // can hold a chunk it hasn't handed out
+  nodes += nodes / (ARENA_CHUNK / MAX_MOVES) + (size_t)threads * ARENA_CHUNK;
+  return nodes < ARENA_NODES ? nodes : ARENA_NODES;
+}
+
+/**
+ * \brief allocates the two arenas of an engine
+ * \param size the number of board states each arena holds, see arena_nodes
+ * \return false if out of memory (the arenas are freed by arena_free either way)
+ */
+static bool arena_init(Arena *arenas, const size_t size) {
+  for (int i = 0; i < 2; ++i) {
+    arenas[i].base = malloc(sizeof(BoardState) * size);
+    if (arenas[i].base == NULL) return false;
+    arenas[i].size = size;
+    arena_drop(&arenas[i]);
+  }
+  return true;
+}
+
+static void arena_free(Arena *arenas) {
+  for (int i = 0; i < 2; ++i) {
+    free(arenas[i].base);
+    arenas[i].base = NULL;
+  }
+}
+
+/**
+ * \brief allocates an array of board states from the active arena
+ * \param count the number of board states (at most ARENA_CHUNK)
+ * \return the array, or NULL if the arena is full
+ */
+static BoardState *arena_alloc(const int8_t count) {
+  Arena *arena = &engine->arenas[engine->activeArena];
+  const unsigned int generation = atomic_load_explicit(&arena->generation, memory_order_acquire);
+  if (arenaCursor.generation != generation || arenaCursor.arena != arena ||
+      arenaCursor.end - arenaCursor.next < count) {
+    // claim a new chunk (the rest of the old one is wasted)
+    const size_t start = atomic_fetch_add_explicit(&arena->top, ARENA_CHUNK, memory_order_relaxed);
+    if (start + ARENA_CHUNK > arena->size) {
+      return NULL;
+    }
+    arenaCursor.next = arena->base + start;
+    arenaCursor.end = arenaCursor.next + ARENA_CHUNK;
+    arenaCursor.arena = arena;
+    arenaCursor.generation = generation;
+  }
+
+  BoardState *boards = arenaCursor.next;
+  arenaCursor.next += count;
+  return boards;
+}
+
+/**
+ * \brief copies all the children of a board state into another arena
+ * \param from the arena the children are in
+ * \param to the arena to copy into
+ * \param state the board state to copy the children of (updated to point to the copies)
+ */
+static void arena_copy_children(const Arena *from, Arena *to, BoardState *state) {
+  if (state->lenStates <= 0) return;
+
+  const size_t offset =
+      atomic_fetch_add_explicit(&to->top, state->lenStates, memory_order_relaxed);
+  BoardState *children = to->base + offset;
+  memcpy(children, from->base + state->nextStates, sizeof(BoardState) * state->lenStates);
+  state->nextStates = (uint32_t)offset;
+
+  for (int i = 0; i < state->lenStates; ++i) {
+    arena_copy_children(from, to, &children[i]);
+  }
+}
+
+/**
+ * \brief drops everything in the active arena except the subtree of one board state
+ * \param state the board state to keep (which must not be in the arena itself)
+ * \note must not be called while a search is running
+ */
+static void arena_keep(BoardState *state) {
+  Arena *spare = &engine->arenas[engine->activeArena ^ 1];
+  arena_drop(spare);
+  arena_copy_children(&engine->arenas[engine->activeArena], spare, state);
+
+  engine->activeArena ^= 1;
+}
+
+/**
+ * \brief drops everything in both arenas
+ * \note must not be called while a search is running
+ */
+static void arena_reset(void) {
+  for (int i = 0; i < 2; ++i) {
+    arena_drop(&engine->arenas[i]);
+  }
+}
+
+// default size of the transposition table
+#define TABLE_DEFAULT_MB 64
+
+// the stored score is exact / at most the real score (cut off) / at least the real score (every
+// move was worse than alpha)
+#define BOUND_EXACT 1
+#define BOUND_LOWER 2
+#define BOUND_UPPER 3
+
+/**
+ * \brief a transposition table entry
+ * \note key is the hash xor'd with data, so an entry torn by two threads writing it at once no
+ * longer matches its hash and is ignored (no locks needed)
+ */
+typedef struct TableEntry {
+  atomic_uint_fast64_t key;
+  atomic_uint_fast64_t data;
+} TableEntry;
+
+typedef struct TableData {
+  int16_t score;
+  uint8_t depth;
+  uint8_t move;
+  uint8_t bound;
+  uint8_t generation;
+} TableData;
+
+// random values for each byte of the player (0-7) and opponent (8-15) bitboards
+static uint64_t ZOBRIST[sizeof(uint64_t) * 2][256];
+
+static TableEntry *table = NULL;
+static size_t tableMask = 0;
+// incremented every move, so entries from earlier moves are replaced first
+static atomic_uchar tableGeneration = 0;
+
+static void zobrist_init(void) {
+  // splitmix64, fixed seed so hashes are the same every run
+  uint64_t seed = 0x48414D4D4552ULL;
+  for (int i = 0; i < sizeof(uint64_t) * 2; ++i) {
+    for (int j = 0; j < 256; ++j) {
+      uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      ZOBRIST[i][j] = z ^ (z >> 31);
+    }
+  }
+}
+
+static inline uint64_t hash_board(const uint64_t player, const uint64_t opponent) {
+  uint64_t hash = 0;
+  for (int i = 0; i < sizeof(uint64_t); ++i) {
+    hash ^= ZOBRIST[i][(player >> (i * 8)) & 0xFF];
+    hash ^= ZOBRIST[i + sizeof(uint64_t)][(opponent >> (i * 8)) & 0xFF];
+  }
+  return hash;
+}
+
+/**
+ * \brief (re)allocates the transposition table, dropping all entries
+ * \param megabytes the maximum size of the table, rounded down to a power of two entries
+ * \return false if the table could not be allocated
+ */
+static bool table_resize(const size_t megabytes) {
+  size_t entries = 1;
+  while (entries * 2 * sizeof(TableEntry) <= megabytes * 1024 * 1024) {
+    entries *= 2;
+  }
+
+  TableEntry *resized = calloc(entries, sizeof(TableEntry));
+  if (resized == NULL) return false;
+
+  free(table);
+  table = resized;
+  tableMask = entries - 1;
+  return true;
+}
+
+static bool table_probe(const uint64_t hash, TableData *out) {
+  TableEntry *entry = &table[hash & tableMask];
+  const uint64_t data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+  const uint64_t key = atomic_load_explicit(&entry->key, memory_order_relaxed);
+  if ((key ^ data) != hash) return false;
+
+  out->score = (int16_t)(uint16_t)data;
+  out->depth = (uint8_t)(data >> 16);
+  out->move = (uint8_t)(data >> 24);
+  out->bound = (uint8_t)(data >> 32);
+  out->generation = (uint8_t)(data >> 40);
+  return true;
+}
+
+static void table_store(const uint64_t hash,
+    const int16_t score,
+    const uint8_t depth,
+    const uint8_t move,
+    const uint8_t bound) {
+  TableEntry *entry = &table[hash & tableMask];
+
+  // keep deeper results from this move over shallower ones for other positions
+  const uint64_t old = atomic_load_explicit(&entry->data, memory_order_relaxed);
+  const uint64_t oldKey = atomic_load_explicit(&entry->key, memory_order_relaxed);
+  if ((oldKey ^ old) != hash && (uint8_t)(old >> 40) == tableGeneration &&
+      (uint8_t)(old >> 16) > depth) {
+    return;
+  }
+
+  const uint64_t data = (uint64_t)(uint16_t)score | (uint64_t)depth << 16 |
+                        (uint64_t)move << 24 | (uint64_t)bound << 32 |
+                        (uint64_t)tableGeneration << 40;
+  atomic_store_explicit(&entry->data, data, memory_order_relaxed);
+  atomic_store_explicit(&entry->key, hash ^ data, memory_order_relaxed);
+}
+
+/**
+ * \brief creates the (pending) children of a board state
+ * \param state the board state to expand
+ * \param player the tiles of the player that made the board state's move
+ * \param opponent the tiles of the player to move
+ * \return false if there was no space left to store the children
+ * \note moves are only applied when the search descends into them or orders them, see
+ * apply_child_move
+ */
+bool generate_child_moves(BoardState *state, const uint64_t player, const uint64_t opponent) {
+  assert(state->lenStates == -1);
+
+  MoveList list;
+  generate_moves(opponent, player, &list);
+
+  if (list.count == 0) {
+    state->nextStates = 0;
+    state->lenStates = 0;
+    return true;
+  }
+
+  BoardState *boards = arena_alloc(list.count);
+  if (boards == NULL) {
+    return false;
+  }
+
+  // the evaluation the values of the moves are relative to, only calculated once
+  const int16_t base = (int16_t)evaluate(opponent, player);
+  for (int8_t move = 0; move < list.count; ++move) {
+    boards[move].nextStates = 0;
+    boards[move].value = base;
+    boards[move].worstBranch = 0;
+    boards[move].index = list.index[move];
+    boards[move].lenStates = STATE_PENDING;
+  }
+
+  state->nextStates = (uint32_t)(boards - engine->arenas[engine->activeArena].base);
+  state->lenStates = list.count;
+  assert(state->lenStates != -1);
+  return true;
+}
+
+/**
+ * \brief converts the final disc differential of a game to a score
+ * \note winning always beats the evaluation, by more discs is better
+ */
+static inline int result_score(const int result) {
+  return result > 0 ? WIN_SCORE + result : (result < 0 ? result - WIN_SCORE : 0);
+}
+
+/**
+ * \brief scores a board state where the player to move has no moves
+ * \param state the board state
+ * \param player the tiles of the player that made the board state's move
+ * \param opponent the tiles of the player to move
+ */
+static void end_game(BoardState *state, const uint64_t player, const uint64_t opponent) {
+  // only a pass, which the tree does not follow, so score it like a leaf
+  if (generate_move_mask(player, opponent)) {
+    state->worstBranch = 0;
+    return;
+  }
+
+  state->worstBranch =
+      (int16_t)(result_score(final_score(opponent, player)) - evaluate(opponent, player));
+}
+
+// bound of search windows, larger than any score
+#define SCORE_INF INT16_MAX
+
+/**
+ * \return true if a stored score is deep enough and its bound settles the search window
+ */
+static inline bool table_bound_cuts(
+    const TableData *entry, const int alpha, const int beta, const int depth) {
+  if (entry->depth < depth) return false;
+  return entry->bound == BOUND_EXACT || (entry->bound == BOUND_LOWER && entry->score >= beta) ||
+         (entry->bound == BOUND_UPPER && entry->score <= alpha);
+}
+
+/**
+ * \brief checks the transposition table before searching a board state
+ * \param state the board state
+ * \param hash the hash of the board state
+ * \param alpha the lower bound of the search window
+ * \param beta the upper bound of the search window
+ * \param depth the depth of the board state
+ * \param bestMove set to the best move found by an earlier search, or NO_MOVE
+ * \return true if the stored score was used and the board state does not need to be searched
+ */
+static bool table_cutoff(BoardState *state,
+    const uint64_t hash,
+    const int alpha,
+    const int beta,
+    const uint8_t depth,
+    uint8_t *bestMove) {
+  TableData entry;
+  *bestMove = NO_MOVE;
+  localTableProbes++;
+  if (!table_probe(hash, &entry)) return false;
+
+  localTableHits++;
+  *bestMove = entry.move;
+  // the root always needs the values of all its moves
+  if (depth == 0 || !table_bound_cuts(&entry, alpha, beta, engine->maxDepth - depth)) return false;
+
+  state->worstBranch = entry.score;
+  return true;
+}
+
+/**
+ * \brief moves the child with the given move to the front, so it is searched first
+ */
+static void order_best_move(BoardState *state, const uint8_t move) {
+  if (move == NO_MOVE) return;
+
+  BoardState *children = node_children(state);
+  for (int i = 1; i < state->lenStates; ++i) {
+    if (children[i].index == move) {
+      const BoardState best = children[i];
+      memmove(&children[1], &children[0], sizeof(BoardState) * i);
+      children[0] = best;
+      return;
+    }
+  }
+}
+
+// only board states with at least this many plies left are fully ordered, below that the hash move
+// is searched first and the rest keep the order of generate_moves
+#define ORDER_MIN_DEPTH 3
+// ordering key of the hash move
+#define ORDER_HASH INT_MAX
+// history scores are halved once any of them grows past this
+#define HISTORY_MAX (1 << 24)
+
+// how often a move (tile index) caused a cutoff, weighted by the plies below it
+static thread_local int history[BOARD_SIZE * BOARD_SIZE];
+// the tableGeneration the history was last aged at
+static thread_local uint8_t historyGeneration = 0;
+
+/**
+ * \brief records a move that caused a cutoff
+ * \param move the index of the move
+ * \param depth the depth of the board state the move was made at
+ */
+static void record_cutoff(const uint8_t move, const uint8_t depth) {
+  localCutoffs++;
+  const int left = engine->maxDepth - depth;
+  history[move] += left * left;
+  if (history[move] > HISTORY_MAX) {
+    for (int i = 0; i < BOARD_SIZE * BOARD_SIZE; ++i) {
+      history[i] /= 2;
+    }
+  }
+}
+
+/**
+ * \brief sorts the children of a board state: hash move, then value, then history
+ * \param state the board state (with children)
+ * \param player the tiles of the player that made the board state's move
+ * \param opponent the tiles of the player to move
+ * \param hashMove the best move found by an earlier search, or NO_MOVE
+ * \param depth the depth of the board state
+ * \note this sets the value of every pending child
+ */
+static void order_moves(BoardState *state,
+    const uint64_t player,
+    const uint64_t opponent,
+    const uint8_t hashMove,
+    const uint8_t depth) {
+  if (engine->maxDepth - depth < ORDER_MIN_DEPTH) {
+    order_best_move(state, hashMove);
+    return;
+  }
+
+  // moves that were good during earlier moves matter less now
+  if (historyGeneration != tableGeneration) {
+    historyGeneration = tableGeneration;
+    for (int i = 0; i < BOARD_SIZE * BOARD_SIZE; ++i) {
+      history[i] /= 2;
+    }
+  }
+
+  BoardState *children = node_children(state);
+  int keys[MAX_MOVES];
+  for (int i = 0; i < state->lenStates; ++i) {
+    BoardState child = children[i];
+    uint64_t nextPlayer, nextOpponent;
+    apply_child_move(player, opponent, &child, &nextPlayer, &nextOpponent);
+
+    int key = ORDER_HASH;
+    if (child.index != hashMove) {
+      // the history only breaks ties, it is a poor predictor with move value scoring
+      key = child.value * 4096 + (history[child.index] >> 12);
+    }
+
+    // insertion sort, there are rarely more than ~15 moves
+    int j = i;
+    for (; j > 0 && keys[j - 1] < key; --j) {
+      children[j] = children[j - 1];
+      keys[j] = keys[j - 1];
+    }
+    children[j] = child;
+    keys[j] = key;
+  }
+}
+
+// ProbCut is only tried with at least this many plies left
+#define PROBCUT_MIN_DEPTH 6
+// how far past the search window a shallow search has to be for the deep one to be skipped by
+// default, by phase, about 2.5 standard deviations of deep - shallow scores
+static const int PROBCUT_DEFAULT_MARGINS[PROBCUT_PHASES] = {30, 55, 150, 280};
+
+/**
+ * \return the depth of the shallow search ProbCut predicts a search of the given depth with
+ * \note about half as deep, with the same parity (the evaluation swings between plies)
+ */
+static inline int probcut_depth(const int depth) {
+  return depth / 4 * 2 + depth % 2;
+}
+
+/**
+ * \return the ProbCut margin of a board
+ */
+static inline int probcut_margin(const uint64_t player, const uint64_t opponent) {
+  return engine->probcutMargins[min(popcount(player | opponent) / 16, PROBCUT_PHASES - 1)];
+}
+
+/**
+ * \brief limits of a search without a tree, one per board being analysed (or per ProbCut search)
+ */
+typedef struct SearchContext {
+  const Evaluator *evaluator;
+  uint64_t nodes;
+  // the search stops after this many nodes, 0 for no limit
+  uint64_t nodeLimit;
+  // time (ms) the search stops at
+  uint64_t deadline;
+  bool aborted;
+  // set if the search is part of the tree search: its nodes are counted as the tree's and it stops
+  // with the tree, instead of at the limits above
+  bool tree;
+  // set if the search is a lazy smp helper, which stops with the tree search (see lazyStop)
+  bool helper;
+  // the moves of the root after the first are searched starting from this one, so helpers
+  // searching the same board prove different moves first
+  int rootOffset;
+} SearchContext;
+
+/**
+ * \brief counts the nodes of a search without a tree, like the tree counts them (every move of
+ * every board that is searched)
+ * \return true if the search has to stop
+ */
+static inline bool stack_count_nodes(SearchContext *ctx, const int count) {
+  const uint64_t nodes = ctx->nodes + count;
+  // the time is only checked once per batch of nodes
+  const bool batch = nodes / NODE_BATCH != ctx->nodes / NODE_BATCH;
+  ctx->nodes = nodes;
+  if (ctx->tree) {
+    return search_count_nodes(count);
+  }
+  if (ctx->helper) {
+    return batch &&
+           (atomic_load_explicit(&engine->lazyStop, memory_order_relaxed) || search_aborted());
+  }
+  return (ctx->nodeLimit != 0 && nodes > ctx->nodeLimit) || (batch && time_ms() >= ctx->deadline);
+}
+
+static int probcut(uint64_t player,
+    uint64_t opponent,
+    int eval,
+    int alpha,
+    int beta,
+    int depth,
+    SearchContext *ctx);
+
+/**
+ * \brief searches a board without building a tree (or touching the head), for analysis
+ * \param player the tiles of the player to move
+ * \param opponent the tiles of the other player
+ * \param eval the evaluation of the board for the player to move
+ * \param alpha the lower bound of the search window
+ * \param beta the upper bound of the search window
+ * \param depth how many plies to search
+ * \param ctx the limits of the search
+ * \param bestMove if not NULL, set to the best move (tile index)
+ * \return the best score for the player to move, relative to eval like the worstBranch of a board
+ * state (fails soft), so the transposition table is shared with the tree search
+ * \note unlike the tree, passes are followed (without using up a ply), below the root subtrees are
+ * pruned with ProbCut
+ */
+static int search_stack(const uint64_t player,
+    const uint64_t opponent,
+    const int eval,
+    int alpha,
+    const int beta,
+    const int depth,
+    SearchContext *ctx,
+    uint8_t *bestMove) {
+  if (depth == 0) return 0;
+
+  MoveList list;
+  generate_moves(player, opponent, &list);
+  if (stack_count_nodes(ctx, list.count)) {
+    ctx->aborted = true;
+    return 0;
+  }
+  if (list.count == 0) {
+    if (!generate_move_mask(opponent, player)) {
+      return result_score(final_score(player, opponent)) - eval;
+    }
+    // the value of a pass is 0, the other player's evaluation is -eval
+    return -search_stack(opponent, player, -eval, -beta, -alpha, depth, ctx, NULL);
+  }
+
+  // the board is stored as the tree would, by the player that made the last move
+  const uint64_t hash = hash_board(opponent, player) ^ ctx->evaluator->hashKey;
+  TableData entry;
+  uint8_t hashMove = NO_MOVE;
+  // searches below the tree and lazy smp helpers count towards its statistics, analyses have none
+  const bool counted = ctx->tree || ctx->helper;
+  if (counted) localTableProbes++;
+  if (table_probe(hash, &entry)) {
+    if (counted) localTableHits++;
+    hashMove = entry.move;
+    if (bestMove == NULL && table_bound_cuts(&entry, alpha, beta, depth)) {
+      return entry.score;
+    }
+  }
+  if (bestMove == NULL) {
+    const int cut = probcut(player, opponent, eval, alpha, beta, depth, ctx);
+    if (ctx->aborted) return 0;
+    if (cut != 0) {
+      if (counted) localProbcuts++;
+      return cut > 0 ? beta : alpha;
+    }
+  }
+
+  // the values are needed to search the moves anyway, so every move is ordered
+  uint64_t flips[MAX_MOVES];
+  int values[MAX_MOVES];
+  int keys[MAX_MOVES];
+  uint8_t index[MAX_MOVES];
+  for (int8_t move = 0; move < list.count; ++move) {
+    int directions;
+    const uint8_t square = list.index[move];
+    const uint64_t flipped = generate_flip_mask(player, opponent, square, &directions);
+    const uint64_t placed = player | flipped | 1ULL << square;
+    const int value = -evaluate_with(ctx->evaluator, opponent & ~flipped, placed) - eval;
+    const int key = square == hashMove ? ORDER_HASH : value;
+
+    int i = move;
+    for (; i > 0 && keys[i - 1] < key; --i) {
+      flips[i] = flips[i - 1];
+      values[i] = values[i - 1];
+      keys[i] = keys[i - 1];
+      index[i] = index[i - 1];
+    }
+    flips[i] = flipped;
+    values[i] = value;
+    keys[i] = key;
+    index[i] = square;
+  }
+
+  const int originalAlpha = alpha;
+  int best = -SCORE_INF;
+  uint8_t bestIndex = NO_MOVE;
+  for (int8_t i = 0; i < list.count; ++i) {
+    // the root can start the moves after the first one at an offset, see SearchContext
+    const int8_t m = bestMove == NULL || i == 0
+                         ? i
+                         : (int8_t)(1 + (i - 1 + ctx->rootOffset) % (list.count - 1));
+    const uint64_t nextPlayer = opponent & ~flips[m];
+    const uint64_t nextOpponent = player | flips[m] | 1ULL << index[m];
+    // the evaluation of the child, for the other player
+    const int next = -(values[m] + eval);
+
+    // the first move gets the full window, the rest a null window and are searched again if they
+    // fail high
+    const int upper = i == 0 ? beta : alpha + 1;
+    int score = values[m] - search_stack(nextPlayer,
+                                nextOpponent,
+                                next,
+                                values[m] - upper,
+                                values[m] - alpha,
+                                depth - 1,
+                                ctx,
+                                NULL);
+    if (i > 0 && score > alpha && score < beta && !ctx->aborted) {
+      score = values[m] - search_stack(nextPlayer,
+                              nextOpponent,
+                              next,
+                              values[m] - beta,
+                              values[m] - alpha,
+                              depth - 1,
+                              ctx,
+                              NULL);
+    }
+    if (ctx->aborted) return 0;
+
+    if (score > best) {
+      best = score;
+      bestIndex = index[m];
+      if (best >= beta) {
+        if (counted) localCutoffs++;
+        break;
+      }
+      alpha = max(alpha, best);
+    }
+  }
+
+  const uint8_t bound =
+      best >= beta ? BOUND_LOWER : (best <= originalAlpha ? BOUND_UPPER : BOUND_EXACT);
+  table_store(hash, (int16_t)best, (uint8_t)depth, bestIndex, bound);
+  if (bestMove != NULL) *bestMove = bestIndex;
+  return best;
+}
+
+/**
+ * \brief ProbCut: predicts whether a deep search of a board fails high or low from a shallow one,
+ * which is searched with a window moved past the real one by the margin of the board's phase
+ * \param depth how many plies the deep search would be
+ * \see search_stack for the other parameters
+ * \return 1 if the deep search (probably) fails high, -1 if it fails low and 0 if it has to be done
+ * \note windows reaching past every score are never cut (those searches find the best line)
+ */
+static int probcut(const uint64_t player,
+    const uint64_t opponent,
+    const int eval,
+    const int alpha,
+    const int beta,
+    const int depth,
+    SearchContext *ctx) {
+  const int margin = probcut_margin(player, opponent);
+  if (depth < PROBCUT_MIN_DEPTH || margin == 0 || alpha <= -SCORE_INF || beta >= SCORE_INF) {
+    return 0;
+  }
+
+  const int shallow = probcut_depth(depth);
+  const int high = beta + margin;
+  if (search_stack(player, opponent, eval, high - 1, high, shallow, ctx, NULL) >= high) {
+    return ctx->aborted ? 0 : 1;
+  }
+  if (ctx->aborted) return 0;
+
+  const int low = alpha - margin;
+  if (search_stack(player, opponent, eval, low, low + 1, shallow, ctx, NULL) <= low) {
+    return ctx->aborted ? 0 : -1;
+  }
+  return 0;
+}
+
+/**
+ * \brief tries to prune a board state of the tree with ProbCut, see probcut
+ * \param depth the depth of the board state
+ * \return true if it was pruned, its worstBranch is set to the bound of the window it failed
+ * \note the shallow searches don't build a tree, see SearchContext.tree
+ * \note this is tried before the board's children are generated, so the boards it prunes take no
+ * space in the arena (boards without moves are left to end_game)
+ */
+static bool probcut_state(BoardState *state,
+    const uint64_t player,
+    const uint64_t opponent,
+    const int alpha,
+    const int beta,
+    const uint8_t depth) {
+  // the root needs the values of all its moves
+  if (depth == 0 || engine->maxDepth - depth < PROBCUT_MIN_DEPTH) return false;
+  if (state->lenStates == 0 || (state->lenStates == -1 && !generate_move_mask(opponent, player))) {
+    return false;
+  }
+
+  SearchContext ctx = {.evaluator = engine->evaluator,
+      .nodes = 0,
+      .nodeLimit = 0,
+      .deadline = UINT64_MAX,
+      .aborted = false,
+      .tree = true};
+  const int cut = probcut(opponent,
+      player,
+      evaluate(opponent, player),
+      alpha,
+      beta,
+      engine->maxDepth - depth,
+      &ctx);
+  if (search_aborted() || cut == 0) return false;
+
+  localProbcuts++;
+  state->worstBranch = (int16_t)(cut > 0 ? beta : alpha);
+  return true;
+}
+
+/**
+ * \brief searches a board state below the plies the tree keeps, with search_stack instead of
+ * expanding it (only the transposition table remembers what was found)
+ * \see search_for_moves_serial
+ */
+static void search_state_stack(BoardState *state,
+    const uint64_t player,
+    const uint64_t opponent,
+    const int alpha,
+    const int beta,
+    const uint8_t depth) {
+  SearchContext ctx = {.evaluator = engine->evaluator,
+      .nodes = 0,
+      .nodeLimit = 0,
+      .deadline = UINT64_MAX,
+      .aborted = false,
+      .tree = true};
+  state->worstBranch = (int16_t)search_stack(opponent,
+      player,
+      evaluate(opponent, player),
+      alpha,
+      beta,
+      engine->maxDepth - depth,
+      &ctx,
+      NULL);
+}
+
+void search_for_moves_serial(BoardState *state,
+    uint64_t player,
+    uint64_t opponent,
+    int alpha,
+    int beta,
+    uint8_t depth);
+
+/**
+ * \brief searches a child of a board state
+ * \param alpha the lower bound of the search window of the board state
+ * \param beta the upper bound of the search window of the board state
+ * \param depth the depth of the board state
+ * \return the score of the child for the board state
+ */
+static inline int search_child_serial(BoardState *child,
+    const uint64_t player,
+    const uint64_t opponent,
+    const int alpha,
+    const int beta,
+    const uint8_t depth) {
+  // the board state scores the child as value - worstBranch, so its window is flipped around value
+  search_for_moves_serial(
+      child, player, opponent, child->value - beta, child->value - alpha, depth + 1);
+  return child->value - child->worstBranch;
+}
+
+/**
+ * \brief finds the score of a board state (its worstBranch) with principal variation search
+ * \param alpha the lower bound of the search window
+ * \param beta the upper bound of the search window
+ * \note fails soft: a score <= alpha is an upper bound and a score >= beta is a lower bound of the
+ * real score
+ * \note only the first treePlies plies are added to the tree, see search_state_stack
+ */
+void search_for_moves_serial(BoardState *state,
+    const uint64_t player,
+    const uint64_t opponent,
+    int alpha,
+    const int beta,
+    const uint8_t depth) {
+  assert(!(player & opponent));
+
+  if (depth >= engine->maxDepth) {
+    // leaves only need to know if the game is over, don't store their children
+    if (state->lenStates > 0 ||
+        (state->lenStates == -1 && generate_move_mask(opponent, player))) {
+      state->worstBranch = 0;
+    } else {
+      end_game(state, player, opponent);
+    }
+    return;
+  }
+
+  if (engine->treePlies != 0 && depth >= engine->treePlies) {
+    search_state_stack(state, player, opponent, alpha, beta, depth);
+    return;
+  }
+
+  const uint64_t hash = hash_board(player, opponent) ^ engine->evaluator->hashKey;
+  uint8_t bestMove = NO_MOVE;
+  if (state->lenStates != 0 && table_cutoff(state, hash, alpha, beta, depth, &bestMove)) {
+    return;
+  }
+
+  if (probcut_state(state, player, opponent, alpha, beta, depth) || search_aborted()) {
+    return;
+  }
+
+  if (state->lenStates == -1 && !generate_child_moves(state, player, opponent)) {
+    // out of space, same as hitting the cutoff
+    search_abort();
+    return;
+  }
+
+  if (state->lenStates == 0) {
+    end_game(state, player, opponent);
+    return;
+  }
+
+  const int alphaOrig = alpha;
+  int best = -SCORE_INF;
+  order_moves(state, player, opponent, bestMove, depth);
+  BoardState *children = node_children(state);
+
+  if (search_count_nodes(state->lenStates)) {
+    return;
+  }
+  // serially iterate over all possible moves
+  for (int i = 0; i < state->lenStates; ++i) {
+    uint64_t nextPlayer, nextOpponent;
+    apply_child_move(player, opponent, &children[i], &nextPlayer, &nextOpponent);
+
+    int score;
+    if (i == 0) {
+      score = search_child_serial(&children[i], nextPlayer, nextOpponent, alpha, beta, depth);
+    } else {
+      // try to prove the move is no better than the best one, only search it fully if it is
+      score = search_child_serial(&children[i], nextPlayer, nextOpponent, alpha, alpha + 1, depth);
+      if (score > alpha && score < beta && !search_aborted()) {
+        score = search_child_serial(&children[i], nextPlayer, nextOpponent, alpha, beta, depth);
+      }
+    }
+    if (search_aborted()) {
+      return;
+    }
+
+    if (i == 0 || score > best) {
+      best = score;
+      bestMove = children[i].index;
+    }
+    if (best >= beta) {
+      record_cutoff(bestMove, depth);
+      break;
+    }
+    // the root keeps moves as good as the best one exact, so it can pick between them
+    alpha = max(alpha, depth == 0 ? best - 1 : best);
+  }
+  state->worstBranch = (int16_t)best;
+
+  const uint8_t bound =
+      best >= beta ? BOUND_LOWER : (best <= alphaOrig ? BOUND_UPPER : BOUND_EXACT);
+  table_store(hash, (int16_t)best, engine->maxDepth - depth, bestMove, bound);
+}
+
+// empty squares left when the endgame solver takes over by default
+#define ENDGAME_DEFAULT_EMPTIES 16
+// with at most this many empty squares moves are ordered by parity instead of mobility
+#define SOLVE_PARITY_EMPTIES 6
+// with at most this many empty squares the empty squares are tried directly, without move masks
+#define SOLVE_SMALL_EMPTIES 4
+// bound of endgame scores (disc differentials)
+#define SOLVE_INF 65
+
+static const uint64_t QUADRANTS[4] = {
+    0x000000000F0F0F0FULL, 0x00000000F0F0F0F0ULL, 0x0F0F0F0F00000000ULL, 0xF0F0F0F000000000ULL};
+
+/**
+ * \return the empty squares in quadrants with an odd number of empty squares
+ */
+static inline uint64_t odd_quadrants(const uint64_t empty) {
+  uint64_t odd = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (popcount(empty & QUADRANTS[i]) & 1) {
+      odd |= empty & QUADRANTS[i];
+    }
+  }
+  return odd;
+}
+
+/**
+ * \brief solves a board state with one empty square
+ * \param player the tiles of the player to move
+ * \param opponent the tiles of the other player
+ * \param index the empty square
+ * \return the final disc differential for the player
+ */
+static inline int solve_1(const uint64_t player, const uint64_t opponent, const uint8_t index) {
+  // 63 tiles, so never a tie
+  const int diff = 2 * popcount(player) - (BOARD_SIZE * BOARD_SIZE - 1);
+  int directions;
+
+  uint64_t flips = generate_flip_mask(player, opponent, index, &directions);
+  if (flips) return diff + 2 * popcount(flips) + 1;
+
+  flips = generate_flip_mask(opponent, player, index, &directions);
+  if (flips) return diff - 2 * popcount(flips) - 1;
+
+  return diff > 0 ? diff + 1 : diff - 1;
+}
+
+/**
+ * \brief solves a board state with at most SOLVE_SMALL_EMPTIES empty squares
+ * \param passed set if the other player could not move before this
+ * \see solve
+ */
+static int solve_small(const uint64_t player,
+    const uint64_t opponent,
+    int alpha,
+    const int beta,
+    const bool passed) {
+  const uint64_t empty = ~(player | opponent);
+  if (popcount(empty) == 1) {
+    return solve_1(player, opponent, (uint8_t)ctz(empty));
+  }
+
+  int best = -SOLVE_INF;
+  bool moved = false;
+  // empty squares in odd quadrants first, the last move of a region is usually made by whoever
+  // moves into it first
+  const uint64_t odd = odd_quadrants(empty);
+  const uint64_t order[2] = {odd, empty & ~odd};
+  for (int i = 0; i < 2; ++i) {
+    for (uint64_t squares = order[i]; squares; squares &= squares - 1) {
+      const uint8_t index = (uint8_t)ctz(squares);
+      int directions;
+      const uint64_t flips = generate_flip_mask(player, opponent, index, &directions);
+      if (!flips) continue;
+
+      moved = true;
+      const int score =
+          -solve_small(opponent & ~flips, player | flips | 1ULL << index, -beta, -alpha, false);
+      if (score > best) {
+        best = score;
+        if (best >= beta) return best;
+        alpha = max(alpha, best);
+      }
+    }
+  }
+
+  if (!moved) {
+    if (passed) return final_score(player, opponent);
+    return -solve_small(opponent, player, -beta, -alpha, true);
+  }
+  return best;
+}
+
+/**
+ * \brief solves a board state exactly, without storing anything
+ * \param player the tiles of the player to move
+ * \param opponent the tiles of the other player
+ * \param alpha the lower bound of the search window
+ * \param beta the upper bound of the search window
+ * \param passed set if the other player could not move before this
+ * \return the final disc differential for the player (fails soft)
+ * \note moves that leave the other player the fewest replies are searched first (fastest first),
+ * near the end moves in odd quadrants are
+ */
+static int solve(const uint64_t player,
+    const uint64_t opponent,
+    int alpha,
+    const int beta,
+    const bool passed) {
+  const uint64_t empty = ~(player | opponent);
+  const int empties = popcount(empty);
+  if (empties <= SOLVE_SMALL_EMPTIES) {
+    return solve_small(player, opponent, alpha, beta, passed);
+  }
+
+  if (search_count_nodes(1)) {
+    return 0;
+  }
+
+  const uint64_t moves = generate_move_mask(player, opponent);
+  if (!moves) {
+    if (passed) return final_score(player, opponent);
+    return -solve(opponent, player, -beta, -alpha, true);
+  }
+
+  uint8_t index[MAX_MOVES];
+  uint64_t flips[MAX_MOVES];
+  int count = 0;
+  if (empties > SOLVE_PARITY_EMPTIES) {
+    int keys[MAX_MOVES];
+    for (uint64_t squares = moves; squares; squares &= squares - 1) {
+      const uint8_t square = (uint8_t)ctz(squares);
+      int directions;
+      const uint64_t flipped = generate_flip_mask(player, opponent, square, &directions);
+      const uint64_t nextPlayer = opponent & ~flipped;
+      const uint64_t nextOpponent = player | flipped | 1ULL << square;
+      const int key = popcount(generate_move_mask(nextPlayer, nextOpponent));
+
+      // insertion sort, fewest replies first
+      int i = count++;
+      for (; i > 0 && keys[i - 1] > key; --i) {
+        index[i] = index[i - 1];
+        flips[i] = flips[i - 1];
+        keys[i] = keys[i - 1];
+      }
+      index[i] = square;
+      flips[i] = flipped;
+      keys[i] = key;
+    }
+  } else {
+    const uint64_t odd = odd_quadrants(empty);
+    const uint64_t order[2] = {moves & odd, moves & ~odd};
+    for (int i = 0; i < 2; ++i) {
+      for (uint64_t squares = order[i]; squares; squares &= squares - 1) {
+        int directions;
+        index[count] = (uint8_t)ctz(squares);
+        flips[count] = generate_flip_mask(player, opponent, index[count], &directions);
+        count++;
+      }
+    }
+  }
+
+  int best = -SOLVE_INF;
+  for (int i = 0; i < count; ++i) {
+    const int score = -solve(
+        opponent & ~flips[i], player | flips[i] | 1ULL << index[i], -beta, -alpha, false);
+    if (search_aborted()) {
+      return 0;
+    }
+    if (score > best) {
+      best = score;
+      if (best >= beta) break;
+      alpha = max(alpha, best);
+    }
+  }
+  return best;
+}
+
+/**
+ * \brief solves every move of the head
+ * \param bestMoves set to the moves (tile indices) with the best score
+ * \param count set to the number of best moves
+ * \param best set to the best score
+ * \return false if the solve was abandoned
+ */
+static bool solve_head(uint8_t *bestMoves, int8_t *count, int16_t *best) {
+  if (engine->head.lenStates == -1 &&
+      !generate_child_moves(&engine->head, engine->headPlayer, engine->headOpponent)) {
+    return false;
+  }
+
+  BoardState *children = node_children(&engine->head);
+  int alpha = -SOLVE_INF;
+  *count = 0;
+  for (int i = 0; i < engine->head.lenStates; ++i) {
+    uint64_t nextPlayer, nextOpponent;
+    apply_child_move(
+        engine->headPlayer, engine->headOpponent, &children[i], &nextPlayer, &nextOpponent);
+    // one below the best score, so moves that tie with it are solved exactly
+    const int score = -solve(nextOpponent, nextPlayer, -SOLVE_INF, -alpha, false);
+    if (search_aborted()) {
+      return false;
+    }
+
+    if (*count == 0 || score > *best) {
+      *best = (int16_t)score;
+      *count = 0;
+      bestMoves[(*count)++] = children[i].index;
+      alpha = score - 1;
+    } else if (score == *best) {
+      bestMoves[(*count)++] = children[i].index;
+    }
+  }
+  return *count > 0;
+}
+
+// maximum number of tasks waiting in a worker's deque
+#define DEQUE_SIZE 1024
+// how many times an idle worker looks for work before sleeping
+#define IDLE_SPINS 64
+
+/**
+ * \brief a chase-lev work stealing deque
+ * \note only the owning worker pushes and pops (bottom), any thread can steal (top)
+ */
+typedef struct Deque {
+  atomic_llong top;
+  atomic_llong bottom;
+  _Atomic(Task *) tasks[DEQUE_SIZE];
+} Deque;
+
+/**
+ * \brief persistent worker threads shared by every search
+ */
+static struct {
+  int workers;
+  Deque *deques;
+  // tasks submitted from outside the pool (only changed while holding lock)
+  _Atomic(Task *) queue;
+  mtx_t lock;
+  // signalled when there is new work for sleeping workers
+  cnd_t work;
+  // signalled when a task group waited on from outside the pool finishes
+  cnd_t done;
+  atomic_int sleeping;
+} pool;
+
+// index of the current thread's deque, or -1 if it is not a worker
+static thread_local int workerId = -1;
+
+static int hardware_threads(void) {
+#ifdef _MSC_VER
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (int)info.dwNumberOfProcessors;
+#else
+  const long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (int)count : 1;
+#endif
+}
+
+static bool deque_push(Deque *deque, Task *task) {
+  const long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+  const long long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+  if (bottom - top >= DEQUE_SIZE) return false;
+
+  atomic_store_explicit(&deque->tasks[bottom % DEQUE_SIZE], task, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+  return true;
+}
+
+static Task *deque_pop(Deque *deque) {
+  const long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+  atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  long long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+  if (top > bottom) {
+    // empty
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return NULL;
+  }
+
+  Task *task = atomic_load_explicit(&deque->tasks[bottom % DEQUE_SIZE], memory_order_relaxed);
+  if (top == bottom) {
+    // last task, race any thieves for it
+    if (!atomic_compare_exchange_strong_explicit(
+            &deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed)) {
+      task = NULL;
+    }
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+  }
+  return task;
+}
+
+static Task *deque_steal(Deque *deque) {
+  long long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+  atomic_thread_fence(memory_order_seq_cst);
+  const long long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+  if (top >= bottom) return NULL;
+
+  Task *task = atomic_load_explicit(&deque->tasks[top % DEQUE_SIZE], memory_order_relaxed);
+  if (!atomic_compare_exchange_strong_explicit(
+          &deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed)) {
+    // another thread took it
+    return NULL;
+  }
+  return task;
+}
+
+static void task_run(Task *task) {
+  TaskGroup *group = task->group;
+  // the group can be gone as soon as its last task is done
+  const bool external = group->external;
+  // the task searches for the engine it was spawned for, the thread's counters so far are flushed
+  // to the engine they were counted for first
+  Engine *previous = engine;
+  if (task->engine != previous) {
+    search_flush_nodes();
+    engine = task->engine;
+  }
+  task->run(task->args);
+  if (engine != previous) {
+    search_flush_nodes();
+    engine = previous;
+  }
+
+  if (atomic_fetch_sub_explicit(&group->pending, 1, memory_order_acq_rel) == 1 && external) {
+    mtx_lock(&pool.lock);
+    cnd_broadcast(&pool.done);
+    mtx_unlock(&pool.lock);
+  }
+}
+
+/**
+ * \brief finds a task to run: from our own deque, the shared queue, or stolen from another worker
+ */
+static Task *pool_find_task(const int id) {
+  Task *task = deque_pop(&pool.deques[id]);
+  if (task != NULL) return task;
+
+  if (atomic_load_explicit(&pool.queue, memory_order_relaxed) != NULL) {
+    mtx_lock(&pool.lock);
+    task = atomic_load_explicit(&pool.queue, memory_order_relaxed);
+    if (task != NULL) {
+      atomic_store_explicit(&pool.queue, task->next, memory_order_relaxed);
+    }
+    mtx_unlock(&pool.lock);
+    if (task != NULL) return task;
+  }
+
+  for (int i = 1; i < pool.workers; ++i) {
+    task = deque_steal(&pool.deques[(id + i) % pool.workers]);
+    if (task != NULL) return task;
+  }
+  return NULL;
+}
+
+static bool pool_has_work(void) {
+  if (atomic_load(&pool.queue) != NULL) return true;
+  for (int i = 0; i < pool.workers; ++i) {
+    if (atomic_load(&pool.deques[i].bottom) > atomic_load(&pool.deques[i].top)) return true;
+  }
+  return false;
+}
+
+static int pool_worker(void *args) {
+  workerId = (int)(intptr_t)args;
+
+  int idle = 0;
+  while (true) {
+    Task *task = pool_find_task(workerId);
+    if (task != NULL) {
+      task_run(task);
+      idle = 0;
+    } else if (++idle < IDLE_SPINS) {
+      thrd_yield();
+    } else {
+      mtx_lock(&pool.lock);
+      atomic_fetch_add(&pool.sleeping, 1);
+      if (!pool_has_work()) {
+        cnd_wait(&pool.work, &pool.lock);
+      }
+      atomic_fetch_sub(&pool.sleeping, 1);
+      mtx_unlock(&pool.lock);
+      idle = 0;
+    }
+  }
+  return 0;
+}
+
+/**
+ * \brief starts the worker threads
+ * \param workers the number of worker threads
+ */
+static bool pool_init(const int workers) {
+  pool.workers = workers;
+  atomic_init(&pool.queue, NULL);
+  pool.deques = calloc(workers, sizeof(Deque));
+  if (pool.deques == NULL) return false;
+  atomic_init(&pool.sleeping, 0);
+  if (mtx_init(&pool.lock, mtx_plain) != thrd_success || cnd_init(&pool.work) != thrd_success ||
+      cnd_init(&pool.done) != thrd_success) {
+    return false;
+  }
+
+  for (int i = 0; i < workers; ++i) {
+    thrd_t thread;
+    if (thrd_create(&thread, pool_worker, (void *)(intptr_t)i) != thrd_success) {
+      return false;
+    }
+    thrd_detach(thread);
+  }
+  return true;
+}
+
+/**
+ * \brief queues a task to be run by the pool
+ * \param group the group the task belongs to (its pending count is incremented)
+ * \param task the task, must stay valid until the group has been waited on
+ */
+static void pool_spawn(TaskGroup *group, Task *task) {
+  task->group = group;
+  task->engine = engine;
+  atomic_fetch_add_explicit(&group->pending, 1, memory_order_relaxed);
+
+  if (workerId == -1 || !deque_push(&pool.deques[workerId], task)) {
+    if (workerId != -1) {
+      // deque full, just run it now
+      task_run(task);
+      return;
+    }
+
+    mtx_lock(&pool.lock);
+    task->next = atomic_load_explicit(&pool.queue, memory_order_relaxed);
+    atomic_store_explicit(&pool.queue, task, memory_order_relaxed);
+    cnd_signal(&pool.work);
+    mtx_unlock(&pool.lock);
+    return;
+  }
+
+  // wake a sleeping worker to steal it
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(&pool.sleeping, memory_order_relaxed) > 0) {
+    mtx_lock(&pool.lock);
+    cnd_signal(&pool.work);
+    mtx_unlock(&pool.lock);
+  }
+}
+
+/**
+ * \brief waits for every task in a group to finish
+ * \note workers run other tasks while waiting instead of blocking
+ */
+static void pool_wait(TaskGroup *group) {
+  if (workerId == -1) {
+    mtx_lock(&pool.lock);
+    while (atomic_load_explicit(&group->pending, memory_order_acquire) > 0) {
+      cnd_wait(&pool.done, &pool.lock);
+    }
+    mtx_unlock(&pool.lock);
+    return;
+  }
+
+  while (atomic_load_explicit(&group->pending, memory_order_acquire) > 0) {
+    Task *task = pool_find_task(workerId);
+    if (task != NULL) {
+      task_run(task);
+    } else {
+      thrd_yield();
+    }
+  }
+}
+
+// only split nodes with at least this many plies left to search
+#define SPLIT_MIN_DEPTH 3
+
+struct SearchArgs {
+  Task task;
+  BoardState *state;
+  uint64_t player;
+  uint64_t opponent;
+  int alpha;
+  int beta;
+  uint8_t depth;
+};
+
+static void search_for_moves_paralell_task(void *args);
+
+void search_for_moves_paralell(BoardState *state,
+    uint64_t player,
+    uint64_t opponent,
+    int alpha,
+    int beta,
+    uint8_t depth);
+
+/**
+ * \brief searches a child of a board state on the thread pool, see search_child_serial
+ */
+static inline int search_child_paralell(BoardState *child,
+    const uint64_t player,
+    const uint64_t opponent,
+    const int alpha,
+    const int beta,
+    const uint8_t depth) {
+  search_for_moves_paralell(
+      child, player, opponent, child->value - beta, child->value - alpha, depth + 1);
+  return child->value - child->worstBranch;
+}
+
+/**
+ * \brief searches a board state, splitting subtrees between the workers of the pool
+ * \note the first move is searched alone so the others are searched with its score (young brothers
+ * wait), nodes with less than SPLIT_MIN_DEPTH plies left are searched serially
+ * \note the other moves are searched in parallel with a null window, those that turn out better
+ * than the best move are searched again (in order) with the full window
+ */
+void search_for_moves_paralell(BoardState *state,
+    const uint64_t player,
+    const uint64_t opponent,
+    int alpha,
+    const int beta,
+    const uint8_t depth) {
+  assert(!(player & opponent));
+
+  if (engine->maxDepth - depth < SPLIT_MIN_DEPTH ||
+      (engine->treePlies != 0 && depth >= engine->treePlies)) {
+    search_for_moves_serial(state, player, opponent, alpha, beta, depth);
+    return;
+  }
+
+  const uint64_t hash = hash_board(player, opponent) ^ engine->evaluator->hashKey;
+  uint8_t bestMove = NO_MOVE;
+  if (state->lenStates != 0 && table_cutoff(state, hash, alpha, beta, depth, &bestMove)) {
+    return;
+  }
+
+  if (probcut_state(state, player, opponent, alpha, beta, depth) || search_aborted()) {
+    return;
+  }
+
+  if (state->lenStates == -1 && !generate_child_moves(state, player, opponent)) {
+    // out of space, same as hitting the cutoff
+    search_abort();
+    return;
+  }
+
+  if (state->lenStates > 0) {
+    const int alphaOrig = alpha;
+    order_moves(state, player, opponent, bestMove, depth);
+    BoardState *children = node_children(state);
+
+    if (search_count_nodes(state->lenStates)) {
+      return;
+    }
+
+    // the first move is searched here, the rest are split off once its score is known
+    uint64_t nextPlayer, nextOpponent;
+    apply_child_move(player, opponent, &children[0], &nextPlayer, &nextOpponent);
+    int best = search_child_paralell(&children[0], nextPlayer, nextOpponent, alpha, beta, depth);
+    if (search_aborted()) {
+      return;
+    }
+    bestMove = children[0].index;
+    alpha = max(alpha, depth == 0 ? best - 1 : best);
+
+    if (best < beta && state->lenStates > 1) {
+      // on the stack, split nodes are too common to allocate at
+      struct SearchArgs tasks[MAX_MOVES];
+      TaskGroup group = {.pending = 0, .external = workerId == -1};
+      const int nullAlpha = alpha;
+
+      // paralelly iterate over the other moves
+      for (int i = 1; i < state->lenStates; ++i) {
+        tasks[i].task.run = search_for_moves_paralell_task;
+        tasks[i].task.args = &tasks[i];
+        tasks[i].state = &children[i];
+        tasks[i].depth = (uint8_t)(depth + 1);
+        apply_child_move(player, opponent, &children[i], &tasks[i].player, &tasks[i].opponent);
+        tasks[i].alpha = children[i].value - (nullAlpha + 1);
+        tasks[i].beta = children[i].value - nullAlpha;
+        pool_spawn(&group, &tasks[i].task);
+      }
+      pool_wait(&group);
+
+      for (int i = 1; i < state->lenStates && !search_aborted(); i++) {
+        int score = children[i].value - children[i].worstBranch;
+        // failed high, so it is at least as good as the best move was
+        if (score > nullAlpha && score < beta) {
+          score = search_child_paralell(
+              &children[i], tasks[i].player, tasks[i].opponent, alpha, beta, depth);
+        }
+        if (score > best) {
+          best = score;
+          bestMove = children[i].index;
+        }
+        if (best >= beta) break;
+        alpha = max(alpha, depth == 0 ? best - 1 : best);
+      }
+
+      if (search_aborted()) {
+        return;
+      }
+    }
+
+    if (best >= beta) {
+      record_cutoff(bestMove, depth);
+    }
+    state->worstBranch = (int16_t)best;
+    const uint8_t bound =
+        best >= beta ? BOUND_LOWER : (best <= alphaOrig ? BOUND_UPPER : BOUND_EXACT);
+    table_store(hash, (int16_t)best, engine->maxDepth - depth, bestMove, bound);
+  } else {
+    end_game(state, player, opponent);
+  }
+#ifdef DEBUG_LOG
+  if (depth == 0) {
+    fprintf(stdout,
+            "%i:%i [n=%i,t=%i,d=%i]: %i\n",
+            static_cast<int>(__popcntq(engine->headPlayer)),
+            static_cast<int>(__popcntq(engine->headOpponent)),
+            engine->head.lenStates,
+            engine->placedTiles,
+            engine->maxDepth,
+            state->worstBranch);
+  }
+#endif
+}
+
+static void search_for_moves_paralell_task(void *args) {
+  const struct SearchArgs *search = args;
+  search_for_moves_paralell(
+      search->state, search->player, search->opponent, search->alpha, search->beta, search->depth);
+  // don't leave nodes behind for the next search to count
+  search_flush_nodes();
+}
+
+/**
+ * \brief a lazy smp helper of the search of the head
+ */
+typedef struct LazyHelper {
+  Task task;
+  // from 1, odd helpers search a ply deeper than the tree and each starts the moves after the
+  // first at its id, so they don't all search the same boards at once
+  int id;
+} LazyHelper;
+
+/**
+ * \brief deepens the head without a tree until the tree search is done, what it finds is only
+ * shared with the tree through the transposition table
+ */
+static void lazy_helper_run(void *args) {
+  const LazyHelper *helper = args;
+  const int empty = BOARD_SIZE * BOARD_SIZE - popcount(engine->headPlayer | engine->headOpponent);
+  SearchContext ctx = {.evaluator = engine->evaluator,
+      .nodes = 0,
+      .nodeLimit = 0,
+      .deadline = UINT64_MAX,
+      .aborted = false,
+      .tree = false,
+      .helper = true,
+      .rootOffset = helper->id};
+  // the opponent moves at the head, see search_state_stack
+  const int eval = evaluate(engine->headOpponent, engine->headPlayer);
+  for (int depth = engine->maxDepth + helper->id % 2; depth <= empty && !ctx.aborted; ++depth) {
+    uint8_t bestMove;
+    search_stack(engine->headOpponent,
+        engine->headPlayer,
+        eval,
+        -SCORE_INF,
+        SCORE_INF,
+        depth,
+        &ctx,
+        &bestMove);
+  }
+  atomic_fetch_add_explicit(&engine->helperVisited, ctx.nodes, memory_order_relaxed);
+  search_flush_counts();
+}
+
+/**
+ * \brief searches the head with lazy smp: the tree is searched serially on this thread while the
+ * other workers of the pool run helpers
+ * \param alpha the lower bound of the window of the head
+ * \param beta the upper bound of the window of the head
+ */
+static void search_head_lazy(const int alpha, const int beta) {
+  LazyHelper *helpers = engine->lazyHelpers;
+  TaskGroup group = {.pending = 0, .external = workerId == -1};
+  atomic_store(&engine->lazyStop, false);
+  for (int i = 0; i < pool.workers - 1; ++i) {
+    helpers[i] = (LazyHelper){.task = {.run = lazy_helper_run, .args = &helpers[i]}, .id = i + 1};
+    pool_spawn(&group, &helpers[i].task);
+  }
+
+  search_for_moves_serial(&engine->head, engine->headPlayer, engine->headOpponent, alpha, beta, 0);
+  search_flush_nodes();
+  atomic_store(&engine->lazyStop, true);
+  pool_wait(&group);
+}
+
+/**
+ * \brief searches the head on the thread pool, in the current search mode
+ * \see search_head_lazy for the parameters
+ */
+static void search_head(const int alpha, const int beta) {
+  if (engine->searchMode == SEARCH_LAZY) {
+    search_head_lazy(alpha, beta);
+    return;
+  }
+
+  struct SearchArgs search = {.task = {.run = search_for_moves_paralell_task, .args = &search},
+      .state = &engine->head,
+      .player = engine->headPlayer,
+      .opponent = engine->headOpponent,
+      .alpha = alpha,
+      .beta = beta,
+      .depth = 0};
+  TaskGroup group = {.pending = 0, .external = workerId == -1};
+  pool_spawn(&group, &search.task);
+  pool_wait(&group);
+}
+
+/**
+ * \brief deepens the head (the opponent to move) until the game ends or the search is stopped
+ */
+static void ponder_run(void *args) {
+  const int empty = BOARD_SIZE * BOARD_SIZE - popcount(engine->headPlayer | engine->headOpponent);
+  for (int depth = 1; depth <= empty; ++depth) {
+    engine->maxDepth = depth;
+    if (engine->searchMode == SEARCH_LAZY) {
+      search_head_lazy(-SCORE_INF, SCORE_INF);
+    } else {
+      search_for_moves_paralell(
+          &engine->head, engine->headPlayer, engine->headOpponent, -SCORE_INF, SCORE_INF, 0);
+    }
+    if (search_aborted()) break;
+    engine->ponderDepth = depth;
+  }
+  search_flush_nodes();
+}
+
+/**
+ * \brief starts searching the head in the background, if pondering is enabled
+ * \note the tree and transposition table keep the results for when the opponent's move is known
+ */
+static void ponder_start(void) {
+  if (!engine->ponderEnabled) return;
+
+  atomic_store(&engine->visited, 0);
+  atomic_store(&engine->searchAborted, false);
+  engine->searchDeadline = UINT64_MAX;
+  engine->ponderDepth = 0;
+  engine->ponderTask = (Task){.run = ponder_run, .args = NULL};
+  pool_spawn(&engine->ponderGroup, &engine->ponderTask);
+}
+
+/**
+ * \brief stops the background search, must be called before anything else uses the tree
+ */
+static void ponder_stop(void) {
+  if (atomic_load_explicit(&engine->ponderGroup.pending, memory_order_acquire) == 0) return;
+
+  search_abort();
+  pool_wait(&engine->ponderGroup);
+  printf("Pondered to depth %i (%llu nodes)\n",
+      engine->maxDepth,
+      (unsigned long long)engine->visited);
+}
+
+/**
+ * \brief stops the background search of every engine, before replacing what they share (the
+ * transposition table or the book)
+ */
+static void ponder_stop_all(void) {
+  Engine *selected = engine;
+  mtx_lock(&enginesLock);
+  for (Engine *other = engines; other != NULL; other = other->next) {
+    engine = other;
+    ponder_stop();
+  }
+  mtx_unlock(&enginesLock);
+  engine = selected;
+}
+
+/**
+ * \brief starts a new tree from a board, dropping the old one
+ * \param player the tiles of the player to move
+ * \param opponent the tiles of the other player
+ */
+static void head_reset(const uint64_t player, const uint64_t opponent) {
+  arena_reset();
+  engine->head =
+      (BoardState){.nextStates = 0, .value = 0, .worstBranch = 0, .index = 0, .lenStates = -1};
+  engine->headPlayer = opponent;
+  engine->headOpponent = player;
+  engine->placedTiles = popcount(player | opponent);
+  // whatever was pondered was for another tree
+  engine->ponderDepth = 0;
+}
+
+/**
+ * \return true if the move (tile index) is one of the moves of the head
+ */
+static bool head_has_move(const uint8_t move) {
+  if (engine->head.lenStates == -1 &&
+      !generate_child_moves(&engine->head, engine->headPlayer, engine->headOpponent)) {
+    return false;
+  }
+
+  const BoardState *children = node_children(&engine->head);
+  for (int i = 0; i < engine->head.lenStates; ++i) {
+    if (children[i].index == move) return true;
+  }
+  return false;
+}
+
+/**
+ * \brief clears the statistics and counters, before searching a new move
+ */
+static void stats_begin(void) {
+  memset(&engine->searchStats, 0, sizeof(engine->searchStats));
+  // until stats_end
+  engine->searchStats.time = time_us();
+  atomic_store(&engine->visited, 0);
+  atomic_store(&engine->cutoffs, 0);
+  atomic_store(&engine->probcuts, 0);
+  atomic_store(&engine->tableProbes, 0);
+  atomic_store(&engine->tableHits, 0);
+  atomic_store(&engine->helperVisited, 0);
+}
+
+/**
+ * \brief fills in the totals of the statistics, after searching a move
+ */
+static void stats_end(void) {
+  engine->searchStats.nodes = engine->visited + engine->helperVisited;
+  engine->searchStats.cutoffs = engine->cutoffs;
+  engine->searchStats.probcuts = engine->probcuts;
+  engine->searchStats.tableProbes = engine->tableProbes;
+  engine->searchStats.tableHits = engine->tableHits;
+  engine->searchStats.time = time_us() - engine->searchStats.time;
+}
+
+void engine_stats(EngineStats *stats) {
+  *stats = engine->searchStats;
+}
+
+// share of the clock kept back for what happens outside the search (python, the game runner)
+#define TIME_RESERVE 0.05
+// how much longer a move can take than its share of the clock, if its best move keeps changing
+#define TIME_EXTEND_MAX 3.0
+// how much the share grows each time the best move changes between iterations
+#define TIME_EXTEND 1.5
+// the most of the clock a single move can use
+#define TIME_MOVE_MAX 0.25
+
+/**
+ * \brief times (ms) a search should finish by
+ */
+typedef struct TimeBudget {
+  // no new iteration is started once half of this is used up (extended while the best move is
+  // unstable, up to hard)
+  uint64_t soft;
+  // the search is abandoned at this
+  uint64_t hard;
+} TimeBudget;
+
+// no time limit
+static const TimeBudget TIME_UNLIMITED = {.soft = UINT64_MAX, .hard = UINT64_MAX};
+
+/**
+ * \return how much of the clock a move (by the number of empty squares) gets, relative to others
+ * \note the opening needs little time, the last moves before the solver (and the first solves)
+ * the most
+ */
+static double time_weight(const int empty) {
+  if (empty > 44) return 0.5;
+  if (empty > engine->endgameEmpties + 10) return 1.0;
+  if (empty >= engine->endgameEmpties - 1) return 2.0;
+  return 0.25;
+}
+
+/**
+ * \brief splits what is left of the clock between our remaining moves
+ * \param start the time (ms) the move started at
+ * \param time_s the time left on our clock
+ * \param empty the number of empty squares
+ */
+static TimeBudget time_budget(const uint64_t start, const double time_s, const int empty) {
+  const double usable = time_s * 1000 * (1 - TIME_RESERVE);
+  if (usable <= 0) {
+    return (TimeBudget){.soft = start, .hard = start};
+  }
+
+  // we make every other move from here on
+  double total = 0;
+  for (int left = empty; left > 0; left -= 2) {
+    total += time_weight(left);
+  }
+  const double share = usable * time_weight(empty) / total;
+  const double longest = max(share, min(share * TIME_EXTEND_MAX, usable * TIME_MOVE_MAX));
+  return (TimeBudget){.soft = start + (uint64_t)share, .hard = start + (uint64_t)longest};
+}
+
+// iterations this deep search a window around the score of the one before, which prunes much more
+// than a full window when the score doesn't move far
+#define ASPIRATION_MIN_DEPTH 5
+// half the width of the first window, it is doubled each time the score falls outside of it
+#define ASPIRATION_WINDOW 24
+
+/**
+ * \brief widens an aspiration window on the side a search failed on
+ * \param score the score the search of the window returned
+ * \param alpha the lower bound of the window (-SCORE_INF if unbounded)
+ * \param beta the upper bound of the window (SCORE_INF if unbounded)
+ * \param window the amount the window was last widened by, doubled
+ * \return false if the score is exact (inside the window), so no search again is needed
+ */
+static bool aspiration_widen(const int score, int *alpha, int *beta, int *window) {
+  if (score <= *alpha && *alpha > -SCORE_INF) {
+    *alpha = max(-SCORE_INF, score - *window);
+  } else if (score >= *beta && *beta < SCORE_INF) {
+    *beta = min(SCORE_INF, score + *window);
+  } else {
+    return false;
+  }
+  *window *= 2;
+  return true;
+}
+
+/**
+ * \brief finds the best moves of the head, searching one ply deeper each iteration until the game
+ * ends, the depth limit is reached or time runs out
+ * \param start the time (ms) the search started at
+ * \param budget when the search has to stop
+ * \param depthLimit the deepest iteration to search
+ * \param bestMoves set to the best moves (tile indices) of the last completed iteration
+ * \param best set to the value of the best moves
+ * \return the number of best moves
+ * \note close to the end the game is solved instead, see solve_head
+ * \note deeper iterations start with an aspiration window around the score of the last one
+ */
+static int8_t search_best_moves(const uint64_t start,
+    const TimeBudget *budget,
+    const int depthLimit,
+    uint8_t *bestMoves,
+    int16_t *best) {
+  int8_t idx = 0;
+  const int8_t empty = BOARD_SIZE * BOARD_SIZE - engine->placedTiles + 1;
+
+  // close to the end solve the game exactly, falling back to searching it if that takes too long
+  bool solved = false;
+  if (empty <= engine->endgameEmpties && depthLimit >= empty) {
+    engine->maxDepth = empty;
+    atomic_store(&engine->searchAborted, false);
+    engine->searchDeadline = start + (budget->hard - start) / 2;
+    // nothing is stored, so only the time matters
+    engine->searchNodeLimit = UINT64_MAX;
+    solved = solve_head(bestMoves, &idx, best);
+    search_flush_nodes();
+    engine->searchNodeLimit = MOVE_CUTOFF;
+
+    if (solved) {
+      engine->searchStats.depth = empty;
+      engine->searchStats.solved = true;
+    } else {
+      printf("Abandoned solve (%i empty)\n", empty);
+    }
+  }
+
+  uint64_t soft = budget->soft;
+  // the best move of the previous iteration
+  uint8_t previous = NO_MOVE;
+  // search one ply deeper each iteration, until the game ends or we run out of time
+  for (int depth = 1; !solved && depth <= min(empty, depthLimit); ++depth) {
+    engine->maxDepth = depth;
+    const uint64_t before = engine->visited + engine->helperVisited;
+    atomic_store(&engine->searchAborted, false);
+    // the first iteration always completes so there is a move to make
+    engine->searchDeadline = depth == 1 ? UINT64_MAX : budget->hard;
+
+    // calculate the best possible move, until its score falls inside the window
+    int window = ASPIRATION_WINDOW;
+    int alpha = depth >= ASPIRATION_MIN_DEPTH && idx > 0 ? *best - window : -SCORE_INF;
+    int beta = depth >= ASPIRATION_MIN_DEPTH && idx > 0 ? *best + window : SCORE_INF;
+    for (;;) {
+      if (engine->maxDepth >= 5) {
+        search_head(alpha, beta);
+      } else {
+        // otherwise search serially
+        search_for_moves_serial(
+            &engine->head, engine->headPlayer, engine->headOpponent, alpha, beta, 0);
+        search_flush_nodes();
+      }
+      if (search_aborted() || !aspiration_widen(engine->head.worstBranch, &alpha, &beta, &window)) {
+        break;
+      }
+      engine->searchStats.researches++;
+    }
+
+    engine->searchStats.depthNodes[depth - 1] = engine->visited + engine->helperVisited - before;
+    engine->searchStats.iterations = depth;
+    if (search_aborted()) {
+      printf("Abandoned depth %i\n", depth);
+      engine->searchStats.nodeLimitHit = engine->visited > engine->searchNodeLimit;
+      break;
+    }
+    engine->searchStats.depth = depth;
+
+    // find the best moves from all the possible moves
+    BoardState *children = node_children(&engine->head);
+    idx = 0;
+    *best = INT16_MIN;
+    for (int8_t i = 0; i < engine->head.lenStates; ++i) {
+      // never searched (cut off)
+      if (children[i].lenStates == STATE_PENDING) continue;
+      const int16_t realVal = children[i].value - children[i].worstBranch;
+      // if the move is better than the current best, reset the list of best moves
+      if (realVal > *best) {
+        *best = realVal;
+        idx = 0;
+        bestMoves[idx++] = children[i].index;
+      } else if (realVal == *best) {
+        // otherwise append the move to the list of best moves
+        bestMoves[idx++] = children[i].index;
+      }
+    }
+
+    // the best move changed, so a deeper search is more likely to change it again: take longer
+    bool stable = previous == NO_MOVE;
+    for (int8_t i = 0; i < idx; ++i) {
+      stable |= bestMoves[i] == previous;
+    }
+    if (!stable) {
+      const double extended = (double)start + (double)(soft - start) * TIME_EXTEND;
+      soft = extended >= (double)budget->hard ? budget->hard : (uint64_t)extended;
+    }
+    previous = bestMoves[0];
+
+    // nothing to decide, or the next iteration would (probably) not finish in time
+    if (engine->head.lenStates <= 1 || time_ms() - start > (soft - start) / 2) {
+      break;
+    }
+
+    // the next iteration searches the best move first
+    if (idx > 0) {
+      order_best_move(&engine->head, bestMoves[0]);
+    }
+  }
+
+  return idx;
+}
+
+// records buffered before they are handed to the writer thread
+#define RECORD_BATCH 4096
+
+/**
+ * \brief the position recording, appended to in batches by a thread of its own
+ */
+static struct {
+  // only changed while holding lock (NULL when there is no recording)
+  FILE *file;
+  mtx_t lock;
+  // signalled when a batch is handed to the writer, or the recording closes
+  cnd_t full;
+  // signalled when the writer is done with its batch
+  cnd_t written;
+  thrd_t writer;
+  // the batch being filled by the searches, and the one being written
+  PositionRecord *filling;
+  PositionRecord *writing;
+  size_t count;
+  // records of the writing batch left to write, 0 if the writer is idle
+  size_t pending;
+  bool closing;
+  bool initialized;
+  // checked before taking the lock, so searches without a recording don't contend for it
+  atomic_bool active;
+} recorder;
+
+static int record_writer(void *args) {
+  FILE *file = args;
+  mtx_lock(&recorder.lock);
+  while (true) {
+    while (recorder.pending == 0 && !recorder.closing) {
+      cnd_wait(&recorder.full, &recorder.lock);
+    }
+    if (recorder.pending == 0) break;
+
+    mtx_unlock(&recorder.lock);
+    fwrite(recorder.writing, sizeof(PositionRecord), recorder.pending, file);
+    mtx_lock(&recorder.lock);
+    recorder.pending = 0;
+    cnd_broadcast(&recorder.written);
+  }
+  mtx_unlock(&recorder.lock);
+  return 0;
+}
+
+/**
+ * \brief hands the filled batch to the writer, waiting for it to finish the last one
+ * \note the caller holds the lock
+ */
+static void record_flush(void) {
+  while (recorder.pending != 0) {
+    cnd_wait(&recorder.written, &recorder.lock);
+  }
+  PositionRecord *batch = recorder.writing;
+  recorder.writing = recorder.filling;
+  recorder.filling = batch;
+  recorder.pending = recorder.count;
+  recorder.count = 0;
+  cnd_signal(&recorder.full);
+}
+
+/**
+ * \brief adds a searched position to the recording, if there is one
+ * \param score the score for the player to move, or the final disc differential if solved
+ * \param depth the plies searched (the empty squares if solved)
+ */
+static void record_position(const uint64_t player,
+    const uint64_t opponent,
+    const int score,
+    const int depth,
+    const bool solved) {
+  if (!atomic_load_explicit(&recorder.active, memory_order_relaxed)) return;
+
+  const PositionRecord record = {.player = player,
+      .opponent = opponent,
+      .score = (int16_t)max(INT16_MIN, min(score, INT16_MAX)),
+      .depth = (uint8_t)max(0, min(depth, UINT8_MAX)),
+      .flags = solved ? RECORD_SOLVED : 0};
+  mtx_lock(&recorder.lock);
+  if (recorder.file != NULL) {
+    recorder.filling[recorder.count++] = record;
+    if (recorder.count == RECORD_BATCH) {
+      record_flush();
+    }
+  }
+  mtx_unlock(&recorder.lock);
+}
+
+void engine_record_close(void) {
+  if (!recorder.initialized) return;
+
+  mtx_lock(&recorder.lock);
+  FILE *file = recorder.file;
+  if (file == NULL) {
+    mtx_unlock(&recorder.lock);
+    return;
+  }
+  recorder.file = NULL;
+  atomic_store(&recorder.active, false);
+  record_flush();
+  recorder.closing = true;
+  cnd_signal(&recorder.full);
+  mtx_unlock(&recorder.lock);
+
+  thrd_join(recorder.writer, NULL);
+  fclose(file);
+  free(recorder.filling);
+  free(recorder.writing);
+  recorder.filling = NULL;
+  recorder.writing = NULL;
+}
+
+/**
+ * \brief checks the header of a record file, or writes it if the file is empty
+ * \param file the file, opened for appending and reading
+ */
+static bool record_header(FILE *file) {
+  if (fseek(file, 0, SEEK_END) != 0) return false;
+  const long size = ftell(file);
+  if (size == 0) {
+    const RecordHeader header = {
+        .magic = RECORD_MAGIC, .version = RECORD_VERSION, .recordSize = sizeof(PositionRecord)};
+    return fwrite(&header, sizeof(header), 1, file) == 1;
+  }
+
+  RecordHeader header;
+  if (size < (long)sizeof(header) || fseek(file, 0, SEEK_SET) != 0 ||
+      fread(&header, sizeof(header), 1, file) != 1) {
+    return false;
+  }
+  // appending to a cut off record would misalign every record after it
+  return header.magic == RECORD_MAGIC && header.version == RECORD_VERSION &&
+         header.recordSize == sizeof(PositionRecord) &&
+         (size - sizeof(header)) % sizeof(PositionRecord) == 0 && fseek(file, 0, SEEK_END) == 0;
+}
+
+bool engine_record_open(const char *path) {
+  engine_record_close();
+  if (!recorder.initialized) {
+    if (mtx_init(&recorder.lock, mtx_plain) != thrd_success ||
+        cnd_init(&recorder.full) != thrd_success || cnd_init(&recorder.written) != thrd_success) {
+      return false;
+    }
+    atomic_init(&recorder.active, false);
+    recorder.initialized = true;
+  }
+
+  FILE *file = fopen(path, "a+b");
+  if (file == NULL) return false;
+  recorder.filling = malloc(sizeof(PositionRecord) * RECORD_BATCH);
+  recorder.writing = malloc(sizeof(PositionRecord) * RECORD_BATCH);
+  recorder.count = 0;
+  recorder.pending = 0;
+  recorder.closing = false;
+  if (recorder.filling == NULL || recorder.writing == NULL || !record_header(file) ||
+      thrd_create(&recorder.writer, record_writer, file) != thrd_success) {
+    fclose(file);
+    free(recorder.filling);
+    free(recorder.writing);
+    recorder.filling = NULL;
+    recorder.writing = NULL;
+    return false;
+  }
+
+  mtx_lock(&recorder.lock);
+  recorder.file = file;
+  atomic_store(&recorder.active, true);
+  mtx_unlock(&recorder.lock);
+  return true;
+}
+
+/**
+ * \brief finds the best move of a board with iterative deepening, or the endgame solver
+ * \param analysis the board and limits of the search, the results are written to it
+ * \note the first iteration always completes, so there is a move if the board has any
+ */
+static void search_position(Analysis *analysis) {
+  const uint64_t player = analysis->player;
+  const uint64_t opponent = analysis->opponent;
+  const uint64_t startUs = time_us();
+  const uint64_t start = startUs / 1000;
+  const int empty = BOARD_SIZE * BOARD_SIZE - popcount(player | opponent);
+  const uint64_t moves = generate_move_mask(player, opponent);
+  analysis->move = NO_MOVE;
+  analysis->score = 0;
+
+  // the solver can't stop early, so boards with a budget are searched (to the end if it allows)
+  if (moves && empty <= engine->endgameEmpties && analysis->depth >= empty &&
+      analysis->nodeLimit == 0 && analysis->timeLimit == 0) {
+    const uint64_t before = flushedVisited + localVisited;
+    int alpha = -SOLVE_INF;
+    for (uint64_t squares = moves; squares; squares &= squares - 1) {
+      int directions;
+      const uint8_t square = (uint8_t)ctz(squares);
+      const uint64_t flipped = generate_flip_mask(player, opponent, square, &directions);
+      const int result =
+          -solve(opponent & ~flipped, player | flipped | 1ULL << square, -SOLVE_INF, -alpha, false);
+      if (result > alpha) {
+        alpha = result;
+        analysis->move = square;
+      }
+    }
+    analysis->score = result_score(alpha);
+    analysis->depth = empty;
+    analysis->nodes = flushedVisited + localVisited - before;
+    record_position(player, opponent, alpha, empty, true);
+    analysis->time = time_us() - startUs;
+    return;
+  }
+
+  const Evaluator *evaluator =
+      analysis->evaluator != NULL ? analysis->evaluator : &defaultEvaluator;
+  const int eval = evaluate_with(evaluator, player, opponent);
+  const uint64_t deadline =
+      analysis->timeLimit != 0 ? start + analysis->timeLimit : UINT64_MAX;
+  SearchContext ctx = {.evaluator = evaluator,
+      .nodes = 0,
+      .nodeLimit = 0,
+      .deadline = UINT64_MAX,
+      .aborted = false,
+      .tree = false};
+  // the plies of the last iteration that completed
+  int searched = 0;
+  // the last empty square is filled a ply before the end, the ply after it scores the final board
+  const int depthLimit = analysis->depth >= empty ? empty + 1 : max(1, analysis->depth);
+  for (int plies = 1; plies <= depthLimit; ++plies) {
+    uint8_t bestMove = NO_MOVE;
+    int window = ASPIRATION_WINDOW;
+    int alpha = plies >= ASPIRATION_MIN_DEPTH ? analysis->score - eval - window : -SCORE_INF;
+    int beta = plies >= ASPIRATION_MIN_DEPTH ? analysis->score - eval + window : SCORE_INF;
+    int best;
+    do {
+      best = search_stack(player, opponent, eval, alpha, beta, plies, &ctx, &bestMove);
+    } while (!ctx.aborted && aspiration_widen(best, &alpha, &beta, &window));
+    if (ctx.aborted) break;
+
+    analysis->move = bestMove;
+    analysis->score = eval + best;
+    searched = plies;
+    ctx.nodeLimit = analysis->nodeLimit;
+    ctx.deadline = deadline;
+    // the next iteration would (probably) not finish in time
+    if (time_ms() - start > (deadline - start) / 2) break;
+  }
+  analysis->depth = min(searched, empty);
+  analysis->nodes = ctx.nodes;
+  analysis->time = time_us() - startUs;
+  if (analysis->move != NO_MOVE) {
+    record_position(player, opponent, analysis->score, analysis->depth, false);
+  }
+}
+
+/**
+ * \brief an analysis that runs on the pool
+ */
+typedef struct AnalysisTask {
+  Task task;
+  Analysis *analysis;
+} AnalysisTask;
+
+static void analysis_run(void *args) {
+  search_position(((AnalysisTask *)args)->analysis);
+}
+
+bool engine_analyze(Analysis *analyses, const size_t count) {
+  AnalysisTask *tasks = malloc(sizeof(AnalysisTask) * max(count, 1));
+  if (tasks == NULL) {
+    return false;
+  }
+
+  ponder_stop();
+  TaskGroup group = {.pending = 0, .external = true};
+  atomic_store(&engine->searchAborted, false);
+  engine->searchDeadline = UINT64_MAX;
+  engine->searchNodeLimit = UINT64_MAX;
+  // one board per task
+  for (size_t i = 0; i < count; ++i) {
+    tasks[i] = (AnalysisTask){.analysis = &analyses[i]};
+    tasks[i].task = (Task){.run = analysis_run, .args = &tasks[i]};
+    pool_spawn(&group, &tasks[i].task);
+  }
+  pool_wait(&group);
+  engine->searchNodeLimit = MOVE_CUTOFF;
+  free(tasks);
+  return true;
+}
+
+/**
+ * \return the board with its rows in reverse order (row 1 becomes row 8)
+ */
+static inline uint64_t board_flip_vertical(const uint64_t board) {
+  return bswap(board);
+}
+
+/**
+ * \return the board with its columns in reverse order (column a becomes column h)
+ */
+static inline uint64_t board_mirror(uint64_t board) {
+  board = (board >> 1 & 0x5555555555555555ULL) | (board & 0x5555555555555555ULL) << 1;
+  board = (board >> 2 & 0x3333333333333333ULL) | (board & 0x3333333333333333ULL) << 2;
+  return (board >> 4 & 0x0F0F0F0F0F0F0F0FULL) | (board & 0x0F0F0F0F0F0F0F0FULL) << 4;
+}
+
+/**
+ * \return the board reflected along the a1-h8 diagonal (rows become columns)
+ * \note swaps the off-diagonal 4x4, then 2x2 and then single tile blocks
+ */
+static inline uint64_t board_transpose(uint64_t board) {
+  uint64_t swap = 0x0F0F0F0F00000000ULL & (board ^ board << 28);
+  board ^= swap ^ swap >> 28;
+  swap = 0x3333000033330000ULL & (board ^ board << 14);
+  board ^= swap ^ swap >> 14;
+  swap = 0x5500550055005500ULL & (board ^ board << 7);
+  return board ^ swap ^ swap >> 7;
+}
+
+// the rotations and reflections of the board (8 with the identity)
+#define SYMMETRIES 8
+
+/**
+ * \brief applies one of the symmetries of the board
+ * \param symmetry bit 2 transposes the board, then bit 1 flips it vertically and bit 0 mirrors it
+ */
+static inline uint64_t board_symmetry(uint64_t board, const int symmetry) {
+  if (symmetry & 4) board = board_transpose(board);
+  if (symmetry & 2) board = board_flip_vertical(board);
+  if (symmetry & 1) board = board_mirror(board);
+  return board;
+}
+
+/**
+ * \brief undoes board_symmetry
+ */
+static inline uint64_t board_symmetry_inverse(uint64_t board, const int symmetry) {
+  if (symmetry & 1) board = board_mirror(board);
+  if (symmetry & 2) board = board_flip_vertical(board);
+  if (symmetry & 4) board = board_transpose(board);
+  return board;
+}
+
+/**
+ * \brief replaces a board with the smallest (by player, then opponent) of its symmetries, so
+ * boards that are rotations or reflections of each other become the same board
+ * \return the symmetry that was applied, see board_symmetry
+ */
+static int board_canonical(uint64_t *player, uint64_t *opponent) {
+  int canonical = 0;
+  uint64_t bestPlayer = *player;
+  uint64_t bestOpponent = *opponent;
+  for (int symmetry = 1; symmetry < SYMMETRIES; ++symmetry) {
+    const uint64_t p = board_symmetry(*player, symmetry);
+    const uint64_t o = board_symmetry(*opponent, symmetry);
+    if (p < bestPlayer || (p == bestPlayer && o < bestOpponent)) {
+      bestPlayer = p;
+      bestOpponent = o;
+      canonical = symmetry;
+    }
+  }
+  *player = bestPlayer;
+  *opponent = bestOpponent;
+  return canonical;
+}
+
+// "HAMRBOK2", the first 8 bytes of an opening book (the first version stored every symmetry)
+#define BOOK_MAGIC 0x324B4F42524D4148ULL
+
+/**
+ * \brief an opening book: a header followed by entries sorted by (player, opponent)
+ * \note stored in native byte order, with only the canonical board of each set of symmetric boards
+ * (and its move), see board_canonical
+ */
+typedef struct BookHeader {
+  uint64_t magic;
+  uint64_t count;
+} BookHeader;
+
+typedef struct BookEntry {
+  // tiles of the player to move, and of the other player
+  uint64_t player;
+  uint64_t opponent;
+  // value of the move when the book was built
+  int16_t score;
+  // tile index of the move to make
+  uint8_t move;
+  // depth the move was searched to
+  uint8_t depth;
+  uint8_t reserved[4];
+} BookEntry;
+
+// the mapped book file, shared with every other process using it
+static struct {
+  void *data;
+  size_t size;
+  const BookEntry *entries;
+  uint64_t count;
+} book;
+
+static void book_close(void) {
+  if (book.data == NULL) return;
+#ifdef _MSC_VER
+  UnmapViewOfFile(book.data);
+#else
+  munmap(book.data, book.size);
+#endif
+  book.data = NULL;
+  book.entries = NULL;
+  book.count = 0;
+}
+
+/**
+ * \brief maps an opening book file, replacing the current book
+ * \param path the path of the book
+ * \return false if the file could not be mapped or is not a book
+ */
+static bool book_open(const char *path) {
+  void *data;
+  size_t size;
+#ifdef _MSC_VER
+  HANDLE file = CreateFileA(
+      path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) return false;
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(BookHeader)) {
+    CloseHandle(file);
+    return false;
+  }
+  size = (size_t)fileSize.QuadPart;
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (mapping == NULL) return false;
+  data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (data == NULL) return false;
+#else
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(BookHeader)) {
+    close(fd);
+    return false;
+  }
+  size = (size_t)info.st_size;
+  data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return false;
+#endif
+
+  const BookHeader *header = data;
+  if (header->magic != BOOK_MAGIC ||
+      header->count > (size - sizeof(BookHeader)) / sizeof(BookEntry)) {
+#ifdef _MSC_VER
+    UnmapViewOfFile(data);
+#else
+    munmap(data, size);
+#endif
+    return false;
+  }
+
+  book_close();
+  book.data = data;
+  book.size = size;
+  book.entries = (const BookEntry *)(header + 1);
+  book.count = header->count;
+  return true;
+}
+
+static int book_compare(const uint64_t player, const uint64_t opponent, const BookEntry *entry) {
+  if (player != entry->player) return player < entry->player ? -1 : 1;
+  if (opponent != entry->opponent) return opponent < entry->opponent ? -1 : 1;
+  return 0;
+}
+
+/**
+ * \brief looks up a board (or one of its symmetries) in the opening book
+ * \param player the tiles of the player to move
+ * \param opponent the tiles of the other player
+ * \param move set to the move of the entry, turned back to the board
+ * \return the book entry of the board, or NULL if it is not in the book
+ */
+static const BookEntry *book_find(uint64_t player, uint64_t opponent, uint8_t *move) {
+  const int symmetry = board_canonical(&player, &opponent);
+  uint64_t low = 0;
+  uint64_t high = book.count;
+  while (low < high) {
+    const uint64_t mid = low + (high - low) / 2;
+    const int order = book_compare(player, opponent, &book.entries[mid]);
+    if (order == 0) {
+      const BookEntry *entry = &book.entries[mid];
+      if (entry->move >= BOARD_SIZE * BOARD_SIZE) return NULL;
+      *move = (uint8_t)ctz(board_symmetry_inverse(1ULL << entry->move, symmetry));
+      return entry;
+    }
+    if (order < 0) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  return NULL;
+}
+
+static int book_sort(const void *a, const void *b) {
+  const BookEntry *entry = a;
+  return book_compare(entry->player, entry->opponent, b);
+}
+
+/**
+ * \brief adds every board reachable from a board within some plies (with a move to make)
+ * \param entries the boards found so far, grown as needed
+ * \param count the number of boards found so far
+ * \param capacity the number of boards entries has space for
+ * \return false if out of memory
+ */
+static bool book_collect(const uint64_t player,
+    const uint64_t opponent,
+    const int plies,
+    BookEntry **entries,
+    size_t *count,
+    size_t *capacity) {
+  if (plies == 0) return true;
+
+  uint64_t moves = generate_move_mask(player, opponent);
+  if (!moves) {
+    // pass, unless the game is over
+    return !generate_move_mask(opponent, player) ||
+           book_collect(opponent, player, plies - 1, entries, count, capacity);
+  }
+
+  if (*count == *capacity) {
+    const size_t grown = *capacity ? *capacity * 2 : 1024;
+    BookEntry *resized = realloc(*entries, grown * sizeof(BookEntry));
+    if (resized == NULL) return false;
+    *entries = resized;
+    *capacity = grown;
+  }
+  // symmetric boards have symmetric moves, so only one of them is searched and stored
+  uint64_t canonicalPlayer = player;
+  uint64_t canonicalOpponent = opponent;
+  board_canonical(&canonicalPlayer, &canonicalOpponent);
+  (*entries)[(*count)++] = (BookEntry){.player = canonicalPlayer, .opponent = canonicalOpponent};
+
+  for (; moves; moves &= moves - 1) {
+    const uint8_t index = (uint8_t)ctz(moves);
+    int directions;
+    const uint64_t flips = generate_flip_mask(player, opponent, index, &directions);
+    if (!book_collect(opponent & ~flips,
+            player | flips | 1ULL << index,
+            plies - 1,
+            entries,
+            count,
+            capacity)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * \brief searches every board within some plies of the start and writes the best moves to a book
+ * \param path the path to write the book to
+ * \param plies how many plies from the start the book covers
+ * \param depth how deep each board is searched
+ * \return the number of boards in the book, or -1 if out of memory or the file couldn't be written
+ * \note this uses (and resets) the search tree
+ */
+static int64_t book_build(const char *path, const int plies, const int depth) {
+  BookEntry *entries = NULL;
+  size_t count = 0;
+  size_t capacity = 0;
+  const uint64_t startPlayer = 1ULL << 28 | 1ULL << 35;
+  const uint64_t startOpponent = 1ULL << 27 | 1ULL << 36;
+  if (!book_collect(startPlayer, startOpponent, plies, &entries, &count, &capacity)) {
+    free(entries);
+    return -1;
+  }
+
+  // the same board is often reached by different moves (or a symmetry of it)
+  qsort(entries, count, sizeof(BookEntry), book_sort);
+  size_t unique = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (unique == 0 || book_sort(&entries[unique - 1], &entries[i]) != 0) {
+      entries[unique++] = entries[i];
+    }
+  }
+
+  for (size_t i = 0; i < unique; ++i) {
+    head_reset(entries[i].player, entries[i].opponent);
+    engine->placedTiles++;
+    atomic_store(&engine->visited, 0);
+    tableGeneration++;
+
+    uint8_t bestMoves[MAX_MOVES];
+    int16_t best = INT16_MIN;
+    search_best_moves(time_ms(), &TIME_UNLIMITED, depth, bestMoves, &best);
+    entries[i].move = bestMoves[0];
+    entries[i].score = best;
+    entries[i].depth = (uint8_t)depth;
+  }
+  head_reset(0, 0);
+
+  FILE *file = fopen(path, "wb");
+  const BookHeader header = {.magic = BOOK_MAGIC, .count = unique};
+  bool written = file != NULL && fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 fwrite(entries, sizeof(BookEntry), unique, file) == unique;
+  if (file != NULL) {
+    written &= fclose(file) == 0;
+  }
+  free(entries);
+  return written ? (int64_t)unique : -1;
+}
+
+/**
+ * \brief finds the move to make and advances the head past it
+ * \param ours the tiles of the player to move (us)
+ * \param theirs the tiles of the other player
+ * \param time_s the time left on our clock
+ * \return the tile index of the move, or NO_MOVE if there is none
+ * \note the tree is kept between moves if the board follows from the head
+ */
+uint8_t engine_move(const uint64_t ours, const uint64_t theirs, const double time_s) {
+  ponder_stop();
+
+  if ((engine->headPlayer | engine->headOpponent) != 0) {
+    // the search can skip expanding our move when the transposition table already had its score
+    if (engine->head.lenStates == -1) {
+      generate_child_moves(&engine->head, engine->headPlayer, engine->headOpponent);
+    }
+
+    // find the move that was made
+    BoardState *children = node_children(&engine->head);
+    for (int i = 0; i < engine->head.lenStates; ++i) {
+      if (theirs & 1ULL << children[i].index) {
+        printf(
+            "Opponent: %i, %i\n", children[i].index % BOARD_SIZE, children[i].index / BOARD_SIZE);
+
+        uint64_t nextPlayer, nextOpponent;
+        apply_child_move(
+            engine->headPlayer, engine->headOpponent, &children[i], &nextPlayer, &nextOpponent);
+
+        puts("OPP BEFORE");
+        print_board(engine->headPlayer, engine->headOpponent);
+        puts("OPP AFTER");
+        print_board(nextOpponent, nextPlayer);
+
+        // set the new board state, dropping all the other moves
+        engine->head = children[i];
+        engine->headPlayer = nextPlayer;
+        engine->headOpponent = nextOpponent;
+        arena_keep(&engine->head);
+
+#ifdef DEBUG_LOG
+        fprintf(stdout, "%i:%i Opponent [t=%i]: %i\n",
+                static_cast<int>(__popcntq(engine->headPlayer)),
+                static_cast<int>(__popcntq(engine->headOpponent)), engine->placedTiles,
+                engine->head.value - engine->head.worstBranch);
+#endif
+        break;
+      }
+    }
+  }
+
+  // first move, or someone passed so the tree does not lead to the board: start again from it
+  if (engine->headPlayer != theirs || engine->headOpponent != ours) {
+    head_reset(ours, theirs);
+  }
+  engine->placedTiles = popcount(ours | theirs);
+
+  engine->placedTiles++;
+
+  const uint64_t start = time_ms();
+  const int8_t empty = BOARD_SIZE * BOARD_SIZE - engine->placedTiles + 1;
+  const TimeBudget budget = time_budget(start, time_s, empty);
+
+  stats_begin();
+  engine->searchStats.ponderDepth = engine->ponderDepth;
+  engine->ponderDepth = 0;
+  tableGeneration++;
+
+  // best moves (tile indices) to pick from
+  uint8_t bestMoves[MAX_MOVES];
+  int8_t idx = 0;
+  // the value of the best move
+  int16_t best = INT16_MIN;
+
+  // opening book moves don't need a search
+  uint8_t bookMove;
+  const BookEntry *entry = book_find(engine->headOpponent, engine->headPlayer, &bookMove);
+  if (entry != NULL && head_has_move(bookMove)) {
+    printf("Book move %i (%i)\n", bookMove, entry->score);
+    bestMoves[idx++] = bookMove;
+    best = entry->score;
+    engine->searchStats.book = true;
+  } else {
+    const int depthLimit = engine->depthLimit > 0 ? min(engine->depthLimit, empty) : empty;
+    idx = search_best_moves(start, &budget, depthLimit, bestMoves, &best);
+  }
+  stats_end();
+
+  if (engine->moveLog) {
+    fprintf(stdout,
+        "Move took: %llums (d=%i)\n",
+        (unsigned long long)(time_ms() - start),
+        engine->maxDepth);
+  }
+
+  // check if there are any moves
+  if (idx == 0) {
+    return NO_MOVE;
+  }
+  if (!engine->searchStats.book) {
+    const bool solved = engine->searchStats.solved;
+    record_position(ours,
+        theirs,
+        solved ? best : best + evaluate(ours, theirs),
+        engine->searchStats.depth,
+        solved);
+  }
+
+  // if there are multiple best moves, pick one at random
+  const uint8_t best_index = bestMoves[rand() % idx];
+  BoardState *children = node_children(&engine->head);
+  int8_t best_move = 0;
+  while (children[best_move].index != best_index) {
+    best_move++;
+  }
+
+  // book moves are not searched, so the child may still need expanding before it is kept
+  uint64_t nextPlayer, nextOpponent;
+  apply_child_move(
+      engine->headPlayer, engine->headOpponent, &children[best_move], &nextPlayer, &nextOpponent);
+  const BoardState next_state = children[best_move];
+
+  assert(!(engine->headPlayer & engine->headOpponent));
+  assert(!(nextPlayer & nextOpponent));
+  printf("before (%i, %i) - Possbile moves %i/%i (max %i)\n",
+         next_state.index % BOARD_SIZE,
+         next_state.index / BOARD_SIZE,
+         idx,
+         engine->head.lenStates,
+         engine->head.worstBranch);
+  print_board(engine->headPlayer, engine->headOpponent);
+  puts("after");
+  print_board(nextOpponent, nextPlayer);
+
+  // set the new board state, dropping all the other moves
+  engine->head = next_state;
+  engine->headPlayer = nextPlayer;
+  engine->headOpponent = nextOpponent;
+  arena_keep(&engine->head);
+  ponder_start();
+  return next_state.index;
+}
+
+/**
+ * \brief gives a zeroed engine the default settings and allocates its arenas and lazy smp helpers
+ * \return false if out of memory
+ */
+static bool engine_setup(Engine *instance) {
+  instance->head =
+      (BoardState){.nextStates = 0, .value = 0, .worstBranch = 0, .index = 0, .lenStates = -1};
+  instance->treePlies = TREE_DEFAULT_PLIES;
+  instance->searchMode = SEARCH_SPLIT;
+  instance->endgameEmpties = ENDGAME_DEFAULT_EMPTIES;
+  instance->evaluator = &defaultEvaluator;
+  instance->moveLog = true;
+  memcpy(instance->probcutMargins, PROBCUT_DEFAULT_MARGINS, sizeof(PROBCUT_DEFAULT_MARGINS));
+  instance->ponderGroup.external = true;
+  instance->searchDeadline = UINT64_MAX;
+  instance->searchNodeLimit = MOVE_CUTOFF;
+  if (pool.workers > 1) {
+    instance->lazyHelpers = malloc(sizeof(LazyHelper) * (pool.workers - 1));
+    if (instance->lazyHelpers == NULL) return false;
+  }
+  return arena_init(instance->arenas, arena_nodes(instance->treePlies, pool.workers + 1));
+}
+
+bool engine_init(const int threads) {
+  line_tables_init();
+  engine_set_kernel(NULL);
+  srand(time(NULL));
+  zobrist_init();
+  eval_init();
+  // the arenas are sized for the workers (and the thread the engine is selected on)
+  return mtx_init(&enginesLock, mtx_plain) == thrd_success &&
+         pool_init(threads > 0 ? threads : hardware_threads()) && engine_setup(&defaultEngine) &&
+         table_resize(TABLE_DEFAULT_MB);
+}
+
+Engine *engine_create(void) {
+  Engine *instance = calloc(1, sizeof(Engine));
+  if (instance != NULL && !engine_setup(instance)) {
+    arena_free(instance->arenas);
+    free(instance->lazyHelpers);
+    free(instance);
+    return NULL;
+  }
+
+  if (instance != NULL) {
+    mtx_lock(&enginesLock);
+    instance->next = engines;
+    engines = instance;
+    mtx_unlock(&enginesLock);
+  }
+  return instance;
+}
+
+void engine_destroy(Engine *instance) {
+  if (instance == NULL) return;
+
+  Engine *previous = engine == instance ? &defaultEngine : engine;
+  engine = instance;
+  ponder_stop();
+  engine = previous;
+
+  mtx_lock(&enginesLock);
+  Engine **link = &engines;
+  while (*link != instance) {
+    link = &(*link)->next;
+  }
+  *link = instance->next;
+  mtx_unlock(&enginesLock);
+  arena_free(instance->arenas);
+  free(instance->lazyHelpers);
+  free(instance);
+}
+
+void engine_select(Engine *instance) {
+  engine = instance != NULL ? instance : &defaultEngine;
+}
+
+void engine_reset(void) {
+  ponder_stop();
+  head_reset(0, 0);
+}
+
+bool engine_set_hash_size(const size_t megabytes) {
+  ponder_stop_all();
+  return table_resize(megabytes);
+}
+
+void engine_set_endgame_empties(const int empties) {
+  ponder_stop();
+  engine->endgameEmpties = empties;
+}
+
+bool engine_set_kernel(const char *name) {
+#ifdef HAMMER_NATIVE
+  // the kernel is fixed when compiling
+  return name == NULL || strcmp(name, kernel->name) == 0;
+#else
+  const CpuFeatures features = cpu_features();
+  if (name == NULL) {
+    kernel = &KERNELS[kernel_best(&features)];
+    return true;
+  }
+
+  for (int id = 0; id < (int)(sizeof(KERNELS) / sizeof(KERNELS[0])); ++id) {
+    if (strcmp(name, KERNELS[id].name) == 0) {
+      if (!kernel_supported(&features, id)) return false;
+      kernel = &KERNELS[id];
+      return true;
+    }
+  }
+  return false;
+#endif
+}
+
+const char *engine_kernel(void) {
+  return kernel->name;
+}
+
+bool engine_set_tree_plies(const int plies) {
+  ponder_stop();
+  const size_t size = arena_nodes(max(plies, 0), pool.workers + 1);
+  if (size != engine->arenas[0].size) {
+    Arena arenas[2] = {{.base = NULL}, {.base = NULL}};
+    if (!arena_init(arenas, size)) {
+      arena_free(arenas);
+      return false;
+    }
+    arena_free(engine->arenas);
+    memcpy(engine->arenas, arenas, sizeof(arenas));
+    engine->activeArena = 0;
+    // the tree was in the old arenas
+    head_reset(engine->headOpponent, engine->headPlayer);
+  }
+  engine->treePlies = max(plies, 0);
+  return true;
+}
+
+void engine_set_search_mode(const int mode) {
+  ponder_stop();
+  engine->searchMode = mode == SEARCH_LAZY ? SEARCH_LAZY : SEARCH_SPLIT;
+}
+
+void engine_set_probcut(const int phase, const int margin) {
+  ponder_stop();
+  if (phase >= 0 && phase < PROBCUT_PHASES) {
+    engine->probcutMargins[phase] = max(margin, 0);
+  }
+}
+
+void engine_set_ponder(const bool enabled) {
+  ponder_stop();
+  engine->ponderEnabled = enabled;
+}
+
+void engine_set_evaluator(const Evaluator *evaluator) {
+  ponder_stop();
+  engine->evaluator = evaluator != NULL ? evaluator : &defaultEvaluator;
+}
+
+void engine_set_depth_limit(const int plies) {
+  ponder_stop();
+  engine->depthLimit = max(plies, 0);
+}
+
+void engine_set_move_log(const bool enabled) {
+  engine->moveLog = enabled;
+}
+
+int64_t engine_load_book(const char *path) {
+  ponder_stop_all();
+  return book_open(path) ? (int64_t)book.count : -1;
+}
+
+int64_t engine_build_book(const char *path, const int plies, const int depth) {
+  ponder_stop();
+  return book_build(path, plies, depth);
+}
+
+void engine_default_weights(EvalWeights *weights) {
+  *weights = (EvalWeights){.corner = EVAL_CORNER,
+      .stable = EVAL_STABLE,
+      .cSquare = EVAL_C_SQUARE,
+      .xSquare = EVAL_X_SQUARE,
+      .edge = EVAL_EDGE,
+      .mobility = EVAL_MOBILITY,
+      .potentialMobility = EVAL_POTENTIAL_MOBILITY,
+      .frontier = EVAL_FRONTIER};
+}
+
+Evaluator *engine_evaluator_create(const EvalWeights *weights) {
+  // every evaluation gets its own hash key
+  static atomic_uint_fast64_t created = 0;
+
+  Evaluator *evaluator = malloc(sizeof(Evaluator));
+  if (evaluator == NULL) {
+    return NULL;
+  }
+  evaluator_build(evaluator, weights);
+
+  // splitmix64
+  uint64_t z = (atomic_fetch_add(&created, 1) + 1) * 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  evaluator->hashKey = z ^ (z >> 31);
+  return evaluator;
+}
+
+void engine_evaluator_destroy(Evaluator *evaluator) {
+  free(evaluator);
+}
+
+void engine_search(Analysis *analysis) {
+  ponder_stop();
+  head_reset(analysis->player, analysis->opponent);
+  engine->placedTiles++;
+  stats_begin();
+  tableGeneration++;
+
+  uint8_t bestMoves[MAX_MOVES];
+  int16_t best = 0;
+  const int8_t count =
+      search_best_moves(time_ms(), &TIME_UNLIMITED, analysis->depth, bestMoves, &best);
+  stats_end();
+  analysis->time = engine->searchStats.time;
+  analysis->nodes = engine->searchStats.nodes;
+  analysis->move = count > 0 ? bestMoves[0] : NO_MOVE;
+  analysis->depth = engine->searchStats.depth;
+  if (engine->searchStats.solved) {
+    analysis->score = result_score(best);
+  } else {
+    analysis->score = best + evaluate(analysis->player, analysis->opponent);
+  }
+  if (count > 0) {
+    record_position(analysis->player,
+        analysis->opponent,
+        engine->searchStats.solved ? best : analysis->score,
+        analysis->depth,
+        engine->searchStats.solved);
+  }
+  head_reset(0, 0);
+}
+
+/**
+ * \brief counts the leaves of the game tree below a board
+ * \note passes count as a ply, finished games as a leaf
+ */
+static uint64_t perft(const uint64_t player, const uint64_t opponent, const int depth) {
+  MoveList list;
+  generate_moves(player, opponent, &list);
+  if (list.count == 0) {
+    if (depth == 1 || !generate_move_mask(opponent, player)) return 1;
+    return perft(opponent, player, depth - 1);
+  }
+  if (depth == 1) return (uint64_t)list.count;
+
+  uint64_t leaves = 0;
+  for (int8_t i = 0; i < list.count; ++i) {
+    int directions;
+    const uint64_t flips = generate_flip_mask(player, opponent, list.index[i], &directions);
+    leaves += perft(opponent & ~flips, player | flips | 1ULL << list.index[i], depth - 1);
+  }
+  return leaves;
+}
+
+uint64_t engine_perft(const uint64_t player, const uint64_t opponent, const int depth) {
+  return depth > 0 ? perft(player, opponent, depth) : 1;
+}
+
+uint64_t engine_legal_moves(const uint64_t player, const uint64_t opponent) {
+  return generate_move_mask(player, opponent);
+}
+
+void engine_play(uint64_t *player, uint64_t *opponent, const uint8_t move) {
+  int directions;
+  const uint64_t flips = generate_flip_mask(*player, *opponent, move, &directions);
+  assert(flips);
+
+  const uint64_t moved = *player | flips | 1ULL << move;
+  *player = *opponent & ~flips;
+  *opponent = moved;
+}
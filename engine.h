@@ -0,0 +1,367 @@
+/**
+ * Hammer: A Reversi Minimax AI
+ * Copyright (C) 2024 marcus8448
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef HAMMER_ENGINE_H
+#define HAMMER_ENGINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// boards are bitboards, bit y * 8 + x is the tile at x, y
+#define BOARD_SIZE 8
+// no move (or no best move stored)
+#define NO_MOVE 0xFF
+// game phases with their own ProbCut margin, by tiles on the board / 16
+#define PROBCUT_PHASES 4
+// how the search is spread between the threads: split subtrees between them, or lazy smp (every
+// thread searches from the root, sharing only the transposition table)
+#define SEARCH_SPLIT 0
+#define SEARCH_LAZY 1
+
+// "HAMRPOSN", the first field of a position record file
+#define RECORD_MAGIC 0x4E534F50524D4148ULL
+#define RECORD_VERSION 1
+// set in the flags of a record of a solved position
+#define RECORD_SOLVED 1
+
+/**
+ * \brief the start of a position record file, the records follow it until the end of the file
+ * \note stored in native byte order, like the records
+ */
+typedef struct RecordHeader {
+  uint64_t magic;
+  uint32_t version;
+  // sizeof(PositionRecord)
+  uint32_t recordSize;
+} RecordHeader;
+
+/**
+ * \brief a searched position, as the recorder writes it (see engine_record_open)
+ */
+typedef struct PositionRecord {
+  // tiles of the player to move, and of the other player
+  uint64_t player;
+  uint64_t opponent;
+  // the score of the best move for the player to move, or the final disc differential if solved
+  int16_t score;
+  // how many plies the search completed (the number of empty squares if solved)
+  uint8_t depth;
+  // RECORD_SOLVED or 0
+  uint8_t flags;
+  uint8_t reserved[4];
+} PositionRecord;
+
+/**
+ * \brief the weights the evaluation tables are built from
+ */
+typedef struct EvalWeights {
+  // an owned corner
+  int corner;
+  // each tile in a same-coloured run from an owned corner (those can't be flipped)
+  int stable;
+  // penalty for a tile next to an empty corner, along an edge (C) or diagonally (X)
+  int cSquare;
+  int xSquare;
+  // the other tiles on the edges
+  int edge;
+  // each legal move
+  int mobility;
+  // each empty square next to the other side's tiles (moves that may open up later)
+  int potentialMobility;
+  // penalty for each tile next to an empty square
+  int frontier;
+} EvalWeights;
+
+/**
+ * \brief an evaluation built from a set of weights
+ */
+typedef struct Evaluator Evaluator;
+
+/**
+ * \brief a board to analyse, and the result
+ */
+typedef struct Analysis {
+  // tiles of the player to move, and of the other player
+  uint64_t player;
+  uint64_t opponent;
+  // how many plies to search, set to the plies the last completed iteration searched (the number
+  // of empty squares if solved)
+  int depth;
+  // deepening stops after this many nodes / milliseconds, 0 for no limit
+  uint64_t nodeLimit;
+  uint32_t timeLimit;
+  // the evaluation to search with, NULL for the default one
+  const Evaluator *evaluator;
+
+  // set to the best move (tile index), or NO_MOVE if there is none
+  uint8_t move;
+  // set to the score of the best move for the player to move
+  int score;
+  // set to the number of nodes and microseconds the search took
+  uint64_t nodes;
+  uint64_t time;
+} Analysis;
+
+/**
+ * \brief what the last search of the game tree did
+ */
+typedef struct EngineStats {
+  // the nodes of each iteration of iterative deepening, by depth - 1 (the last one may have been
+  // abandoned), and how many there were
+  uint64_t depthNodes[BOARD_SIZE * BOARD_SIZE];
+  int iterations;
+  // the deepest iteration that completed (the number of empty squares if solved)
+  int depth;
+  uint64_t nodes;
+  // beta cutoffs, subtrees pruned by ProbCut, and transposition table lookups / lookups that found
+  // the board
+  uint64_t cutoffs;
+  uint64_t probcuts;
+  uint64_t tableProbes;
+  uint64_t tableHits;
+  // how many times the score fell outside an aspiration window, and had to be searched again
+  int researches;
+  // microseconds the move took
+  uint64_t time;
+  // the deepest iteration the search on the opponent's time completed before the move (0 if there
+  // was none)
+  int ponderDepth;
+  // set if an iteration was abandoned for visiting too many nodes
+  bool nodeLimitHit;
+  // set if the game was solved, or the move came from the opening book
+  bool solved;
+  bool book;
+} EngineStats;
+
+/**
+ * \brief the state of one game: its search tree, statistics and settings, so a process can play
+ * several games at once (sharing the search threads, transposition table and opening book)
+ * \note the functions that play or search a game, and the ones that change its settings, use the
+ * engine the calling thread selected, see engine_select
+ * \note each engine allocates two arenas for its tree, sized for the plies it keeps (see
+ * engine_set_tree_plies): about 36MB in all with the default 4 plies, and 720MB when every ply or 5
+ * or more are kept (most of which is never touched, so only takes address space)
+ */
+typedef struct Engine Engine;
+
+/**
+ * \brief sets up the tables and starts the search threads, must be called before anything else
+ * \param threads the number of search threads, 0 for one per hardware thread
+ * \return false if out of memory or the threads could not be started
+ */
+bool engine_init(int threads);
+
+/**
+ * \brief picks the move generation kernel (they all give the same results)
+ * \param name "generic", "avx2" or "bmi2" (pext line lookups), NULL for the fastest one the cpu
+ * runs well, which engine_init picks
+ * \return false if the kernel doesn't exist or the cpu can't run it (or isn't the one a
+ * HAMMER_NATIVE build was compiled with)
+ * \note must not be called while searching
+ */
+bool engine_set_kernel(const char *name);
+
+/**
+ * \return the name of the move generation kernel in use
+ */
+const char *engine_kernel(void);
+
+/**
+ * \return a new engine with the default settings, or NULL if out of memory
+ */
+Engine *engine_create(void);
+
+/**
+ * \brief stops an engine's pondering and frees it, it must not be selected by any thread
+ */
+void engine_destroy(Engine *engine);
+
+/**
+ * \brief makes the calling thread's calls use an engine, until another one is selected
+ * \param engine the engine, NULL for the default one (which every thread starts with)
+ * \note an engine must only be used by one thread at a time
+ */
+void engine_select(Engine *engine);
+
+/**
+ * \brief finds the move to make and advances the game past it
+ * \param ours the tiles of the player to move (us)
+ * \param theirs the tiles of the other player
+ * \param time_s the time left on our clock
+ * \return the tile index of the move, or NO_MOVE if there is none
+ * \note the search tree is kept between moves if the board follows from the last one
+ */
+uint8_t engine_move(uint64_t ours, uint64_t theirs, double time_s);
+
+/**
+ * \brief forgets the current game
+ */
+void engine_reset(void);
+
+/**
+ * \brief resizes the transposition table (clearing it)
+ * \return false if out of memory
+ * \note the table is shared, so this stops every engine's search on the opponent's time, and no
+ * engine may be searching
+ */
+bool engine_set_hash_size(size_t megabytes);
+
+/**
+ * \brief sets how many empty squares the endgame solver takes over at (0 disables it)
+ */
+void engine_set_endgame_empties(int empties);
+
+/**
+ * \brief sets how many plies below the current board the search tree keeps, deeper boards are
+ * searched without being stored (bounding the memory the tree takes)
+ * \param plies the number of plies, 0 keeps every ply
+ * \return false if out of memory for the tree (the setting is left alone)
+ * \note the kept plies are reused on the next move and while pondering, but the tree is dropped
+ * when the number of plies changes how much memory it needs
+ */
+bool engine_set_tree_plies(int plies);
+
+/**
+ * \brief sets how the search of the game tree is spread between the search threads
+ * \param mode SEARCH_SPLIT (the default) to split the subtrees of each board between the threads,
+ * SEARCH_LAZY to search the tree on one thread while the others search the same board without it,
+ * one ply deeper on every other thread, sharing what they find through the transposition table
+ * \note analyses always search one board per thread
+ */
+void engine_set_search_mode(int mode);
+
+/**
+ * \brief sets how far past the search window a shallow search has to be for ProbCut to prune a
+ * subtree (without searching it deeply)
+ * \param phase the phase of the game to set the margin of, below PROBCUT_PHASES
+ * \param margin the margin in evaluation units, 0 disables ProbCut in the phase
+ */
+void engine_set_probcut(int phase, int margin);
+
+/**
+ * \brief enables or disables searching on the opponent's time
+ */
+void engine_set_ponder(bool enabled);
+
+/**
+ * \brief sets the evaluation the game tree is searched with
+ * \param evaluator the evaluation, NULL for the default one
+ * \note the evaluation must not be destroyed while the engine uses it, and the opening book (built
+ * with the default evaluation) is still played from
+ */
+void engine_set_evaluator(const Evaluator *evaluator);
+
+/**
+ * \brief sets the deepest iteration engine_move searches, however much time is left
+ * \param plies the number of plies, 0 for no limit (the default)
+ */
+void engine_set_depth_limit(int plies);
+
+/**
+ * \brief enables (the default) or disables printing how long each move took
+ */
+void engine_set_move_log(bool enabled);
+
+/**
+ * \brief maps an opening book, replacing the current one
+ * \return the number of boards in the book, or -1 if it could not be loaded
+ * \note like engine_set_hash_size, this stops every engine's search on the opponent's time
+ */
+int64_t engine_load_book(const char *path);
+
+/**
+ * \brief builds an opening book, resetting the current game
+ * \param path the path to write the book to
+ * \param plies how many plies from the start the book covers
+ * \param depth how deep each board is searched
+ * \return the number of boards in the book, or -1 if out of memory or the file couldn't be written
+ * \note boards that are rotations or reflections of each other are searched and stored once
+ */
+int64_t engine_build_book(const char *path, int plies, int depth);
+
+/**
+ * \brief starts recording every position searched (by engine_move, engine_search and
+ * engine_analyze, from any engine) with its score, closing the current recording
+ * \param path the file to append the records to, created with a RecordHeader if it doesn't exist
+ * \return false if the file couldn't be opened, is not a record file or the writer thread
+ * couldn't be started
+ * \note the records are buffered and written in batches by a thread of their own
+ */
+bool engine_record_open(const char *path);
+
+/**
+ * \brief writes out the buffered records and closes the recording, if there is one
+ */
+void engine_record_close(void);
+
+/**
+ * \brief finds the best move of every board, spread over the search threads
+ * \return false if out of memory
+ * \note the current game is left alone, boards within the endgame solver's reach are solved when
+ * the depth allows and there is no node or time limit
+ */
+bool engine_analyze(Analysis *analyses, size_t count);
+
+/**
+ * \brief searches a board with the game tree, to a fixed depth and without a time limit
+ * \param analysis the board and depth, the results are written to it (the other limits and the
+ * evaluation are ignored, see engine_set_evaluator) and the depth is set to the deepest iteration
+ * that completed
+ * \note this uses (and resets) the search tree
+ */
+void engine_search(Analysis *analysis);
+
+/**
+ * \brief gets the statistics of the last engine_move or engine_search
+ */
+void engine_stats(EngineStats *stats);
+
+/**
+ * \return the number of leaves of the game tree below a board, passes count as a ply and finished
+ * games as a leaf
+ */
+uint64_t engine_perft(uint64_t player, uint64_t opponent, int depth);
+
+/**
+ * \brief sets the weights the default evaluation is built from
+ */
+void engine_default_weights(EvalWeights *weights);
+
+/**
+ * \return a new evaluation for analyses, or NULL if out of memory
+ */
+Evaluator *engine_evaluator_create(const EvalWeights *weights);
+
+void engine_evaluator_destroy(Evaluator *evaluator);
+
+/**
+ * \return a bitboard of the legal moves of the player to move
+ */
+uint64_t engine_legal_moves(uint64_t player, uint64_t opponent);
+
+/**
+ * \brief plays a legal move
+ * \param player the tiles of the player to move, set to the tiles of the other player (who moves
+ * next)
+ * \param opponent the tiles of the other player, set to the tiles of the player that moved
+ * \param move the tile index of the move
+ */
+void engine_play(uint64_t *player, uint64_t *opponent, uint8_t move);
+
+#endif // HAMMER_ENGINE_H
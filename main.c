@@ -17,937 +17,719 @@
  */
 
 #include <Python.h>
-#include <stdbool.h>
-#include <threads.h>
-#ifdef _MSC_VER
-#include <intrin.h>
-#include <Windows.h>
-#endif
 
-#define BOARD_SIZE 8
-#define MOVE_CUTOFF 15000000
+#include "engine.h"
 
-#ifdef DEBUG_MODE
-#define DEBUG_LOG
-#undef NDEBUG
-#include <assert.h>
-#else
+#ifndef DEBUG_MODE
 #define puts(s) ;
-#define printf(s, ...) ;
-#define putchar(c) ;
-#define fflush(f) ;
 #endif
-#define max(a, b) (a > b ? a : b)
-#include <stdatomic.h>
-
-static int placedTiles = 0;
 
-static void print_board(uint64_t player, uint64_t opponent) {
+/**
+ * \brief reads the tiles of a python board
+ * \param pyBoard the board, a list of rows where empty tiles are tuples
+ * \param pyPlayer the tile of the player to move
+ * \param player set to the tiles of the player to move
+ * \param opponent set to the tiles of the other player
+ */
+static void read_board(
+    PyObject *pyBoard, PyObject *pyPlayer, uint64_t *player, uint64_t *opponent) {
+  *player = 0;
+  *opponent = 0;
   uint8_t index = 0;
   for (uint8_t y = 0; y < BOARD_SIZE; y++) {
+    PyObject *pyRow = PyList_GetItem(pyBoard, y);
     for (uint8_t x = 0; x < BOARD_SIZE; x++, index++) {
-      printf("%c ", ((player >> index) & 0b1) ? 'X' : opponent >> index & 0b1 ? 'O' : '-');
+      PyObject *pyItem = PyList_GetItem(pyRow, x);
+      // if the tile is not a tuple it is a player tile
+      if (!PyTuple_Check(pyItem)) {
+        if (PyObject_RichCompareBool(pyItem, pyPlayer, Py_EQ)) {
+          *player |= 1ULL << index;
+        } else {
+          *opponent |= 1ULL << index;
+        }
+      }
     }
-    putchar('\n');
   }
-  assert(!(player & opponent));
 }
 
-typedef struct BoardState {
-  struct BoardState *nextStates;
-  uint64_t player;
-  uint64_t opponent;
-  int16_t value;
-  int16_t worstBranch;
-  uint8_t x;
-  uint8_t y;
-  int8_t lenStates;
-} BoardState;
-
-static int8_t BOARD_VALUES[BOARD_SIZE * BOARD_SIZE] = {
-    1,   -30,  1,   -1,   -1,    1,   -30,  1,
-    -30, -30,  0,    0,    0,    0,   -30,  -30,
-    1,   0,    0,    0,    0,    0,   0,    1,
-    -1,  0,    0,    0,    0,    0,   0,   -1,
-    -1,  0,    0,    0,    0,    0,   0,   -1,
-    1,   0,    0,    0,    0,    0,   0,    1,
-    -30, -30,  0,    0,    0,    0,   -30,  -30,
-    1,   -30,  1,   -1,   -1,    1,   -30,  1,
-};
-
-static BoardState head = {.nextStates = NULL,
-    .player = 0,
-    .opponent = 0,
-    .value = INT16_MIN,
-    .worstBranch = 0,
-    .x = 0,
-    .y = 0,
-    .lenStates = -1,
-};
-
-static int eval_left(uint64_t p, uint64_t o, uint8_t x, uint8_t y, int16_t changed) {
-  return changed + BOARD_VALUES[y * BOARD_SIZE + x];
-}
+/**
+ * \brief a python Engine: a game of its own (with its own search tree, settings and statistics),
+ * sharing the search threads, transposition table and opening book with the others
+ */
+typedef struct EngineObject {
+  PyObject_HEAD
+  Engine *engine;
+  // set while the engine searches without the gil
+  bool busy;
+} EngineObject;
 
-static int eval_right(uint64_t p, uint64_t o, uint8_t x, uint8_t y, int16_t changed) {
-  return changed + BOARD_VALUES[y * BOARD_SIZE + x];
-}
+static PyTypeObject EngineType;
 
-static int eval_down(uint64_t p, uint64_t o, uint8_t x, uint8_t y, int16_t changed) {
-  return changed + BOARD_VALUES[y * BOARD_SIZE + x];
-}
+// set while the module's own engine searches without the gil
+static bool defaultBusy = false;
+// searches running without the gil, the shared tables can't be replaced while there are any
+static int searches = 0;
 
-static int eval_up(uint64_t p, uint64_t o, uint8_t x, uint8_t y, int16_t changed) {
-  return changed + BOARD_VALUES[y * BOARD_SIZE + x];
+/**
+ * \return the flag of the engine a function works on: the Engine it is a method of, or the
+ * module's
+ */
+static bool *busy_flag(PyObject *self) {
+  return PyObject_TypeCheck(self, &EngineType) ? &((EngineObject *)self)->busy : &defaultBusy;
 }
 
-static int eval_up_left(uint64_t p, uint64_t o, uint8_t x, uint8_t y, int16_t changed) {
-  return changed + BOARD_VALUES[y * BOARD_SIZE + x];
+/**
+ * \brief checks that the engine a function works on isn't searching on another thread
+ * \return false (with an exception set) if it is
+ */
+static bool check_idle(PyObject *self) {
+  if (*busy_flag(self)) {
+    PyErr_SetString(PyExc_RuntimeError, "the engine is searching on another thread");
+    return false;
+  }
+  return true;
 }
 
-static int eval_up_right(uint64_t p, uint64_t o, uint8_t x, uint8_t y, int16_t changed) {
-  return changed + BOARD_VALUES[y * BOARD_SIZE + x];
+/**
+ * \brief marks the engine a function works on as searching, before the gil is released (the
+ * search must not start if this returns false)
+ * \return false (with an exception set) if it is already searching on another thread
+ */
+static bool search_begin(PyObject *self) {
+  if (!check_idle(self)) {
+    return false;
+  }
+  *busy_flag(self) = true;
+  searches++;
+  return true;
 }
 
-static int eval_down_left(uint64_t p, uint64_t o, uint8_t x, uint8_t y, int16_t changed) {
-  return changed + BOARD_VALUES[y * BOARD_SIZE + x];
+/**
+ * \brief marks the engine a function works on as idle again, once the gil is held
+ */
+static void search_end(PyObject *self) {
+  *busy_flag(self) = false;
+  searches--;
 }
 
-static int eval_down_right(uint64_t p, uint64_t o, uint8_t x, uint8_t y, int16_t changed) {
-  return changed + BOARD_VALUES[y * BOARD_SIZE + x];
+/**
+ * \brief checks that no engine is searching, before changing what they share
+ * \return false (with an exception set) if one is
+ */
+static bool check_no_searches(void) {
+  if (searches > 0) {
+    PyErr_SetString(PyExc_RuntimeError, "an engine is searching on another thread");
+    return false;
+  }
+  return true;
 }
 
-static int maxDepth = 0;
-static uint64_t visited = 0;
-
-void generate_child_moves(BoardState *state) {
-  assert(state->lenStates == -1);
-
-  // swap
-  const uint64_t player = state->opponent;
-  const uint64_t opponent = state->player;
-
-  BoardState *boards = malloc(sizeof(BoardState) * 16);
-
-  int8_t move = 0;
-
-  boards[move].nextStates = NULL;
-  boards[move].x = 0;
-  boards[move].y = 0;
-  boards[move].player = player;
-  boards[move].opponent = opponent;
-  boards[move].value = 0;
-  boards[move].worstBranch = 0;
-  boards[move].lenStates = -1;
-
-  // board (byte format)
-  // << 63 62 61 60 59 58 57 56
-  //    55 54 53 52 51 50 49 48
-  //    47 46 45 44 43 42 41 40
-  //    39 38 37 36 35 34 33 32
-  //    31 30 29 28 27 26 25 24
-  //    23 22 21 20 19 18 17 16
-  //    15 14 13 12 11 10 09 08
-  //    07 06 05 04 03 02 01 00 >>
-
-  // 1 = empty, 0 = taken
-  const uint64_t empty = ~(player | opponent);
-
-  // 1 = empty spot adjacent to opponent on the right, 0 = not
-  const uint64_t right = empty & (opponent << 1); // RIGHT EDGE INVALID
-
-  // 1 = empty spot adjacent to opponent on the left, 0 = not
-  const uint64_t left = empty & (opponent >> 1); // LEFT EDGE INVALID
-
-  // 1 = empty spot adjacent to opponent above, 0 = not
-  const uint64_t up = empty & (opponent >> BOARD_SIZE); // TOP ROW DEAD
-
-  // 1 = empty spot adjacent to opponent below, 0 = not
-  const uint64_t down = empty & (opponent << BOARD_SIZE); // BOTTOM ROW DEAD
-
-  // 1 = empty spot adjacent to opponent on the diagonal top-right, 0 = not
-  const uint64_t upRight = empty & (opponent >> (BOARD_SIZE - 1)); // TOP + RIGHT EDGE INVALID
-
-  // 1 = empty spot adjacent to opponent on the diagonal bottom-left, 0 = not
-  const uint64_t downLeft = empty & (opponent << (BOARD_SIZE - 1)); // BOTTOM + LEFT EDGE INVALID
-
-  // 1 = empty spot adjacent to opponent on the diagonal top-left, 0 = not
-  const uint64_t upLeft = empty & (opponent >> (BOARD_SIZE + 1)); // TOP + LEFT EDGE INVALID
+/**
+ * \brief generates a move for the current board state
+ * \param self python module instance
+ * \param args function arguments from python: board, player, time
+ * \return the move to make in a python dict -> list -> tuple
+ */
+static PyObject *revai_ai(PyObject *self, PyObject *args) {
+  puts("Start");
 
-  // 1 = empty spot adjacent to opponent on the diagonal bottom-right, 0 = not
-  const uint64_t downRight = empty & (opponent << (BOARD_SIZE + 1)); // BOTTOM + RIGHT EDGE INVALID
+  // parse arguments
+  PyObject *pyBoard;
+  PyObject *pyPlayer;
+  // time left on our clock
+  double time_s = 0;
+  if (!PyArg_ParseTuple(args, "OOd", &pyBoard, &pyPlayer, &time_s)) {
+    return NULL;
+  }
 
-  // index where tile will be placed
-  uint8_t index = 0;
+  // the tiles on the python board
+  uint64_t ours, theirs;
+  read_board(pyBoard, pyPlayer, &ours, &theirs);
+  if (!search_begin(self)) {
+    return NULL;
+  }
+  // only the board and the result need python, other threads run while searching
+  uint8_t move;
+  Py_BEGIN_ALLOW_THREADS
+  move = engine_move(ours, theirs, time_s);
+  Py_END_ALLOW_THREADS
+  search_end(self);
 
-  // iterate over entire board
-  for (int8_t y = 0; y < BOARD_SIZE; ++y) {
-    for (int8_t x = 0; x < BOARD_SIZE; ++x) {
-      // true if a move is possible, false otherwise
-      bool success = false;
-      // the value of the move (for the current player). Set to 1 to account for the placed tile.
-      int16_t value = 1;
-
-      // start at rightmost (min X) index, move left (+X)
-      if (x + 2 < BOARD_SIZE && left >> index & 0b1) {
-        // testX - x = number of tiles to flip (includes placed tile)
-        // testX - x = offset from index
-        for (int8_t testX = x + 2; testX < BOARD_SIZE; testX++) {
-          const int8_t toFlip = testX - x;
-
-          // if it's an opponent tile, just continue
-          if (!(opponent >> (index + toFlip) & 0b1)) {
-            // empty tile, so fail
-            if (empty >> (index + toFlip) & 0b1) {
-              break;
-            }
-
-            // found self (not opponent or empty), success
-            assert((player >> (index + toFlip)) & 0b1);
-            success = true;
-
-            // take full strip, reduce to flipped length, shift to index
-            const uint64_t mask = ((0b11111111ULL >> (BOARD_SIZE - (toFlip + 1))) << index);
-            assert(mask);
-
-            // set player tiles
-            boards[move].player |= mask;
-            assert(boards[move].player & boards[move].opponent);
-
-            // clear opponent tiles
-            boards[move].opponent &= ~mask;
-            assert(!(boards[move].player & boards[move].opponent));
-
-            // add value of move
-            value += eval_left(boards[move].player, boards[move].opponent, x, y, toFlip - 1);
-            break;
-          }
-        }
-      }
+  // create the python dict to return
+  PyObject *output = PyDict_New();
+  // create the python list of moves
+  PyObject *moves = PyList_New(0);
 
-      // start at leftmost (max X) index, move right (-X)
-      if (x >= 2 && right >> index & 0b1) {
-        // x - testX = number of tiles to flip (includes placed tile)
-        // testX - x = offset from index
-        for (int8_t testX = x - 2; testX >= 0; testX--) {
-          // if it's an opponent tile, just continue
-          if (!(opponent >> (index + (testX - x)) & 0b1)) {
-            // empty tile, so fail
-            if (empty >> (index + (testX - x)) & 0b1) {
-              break;
-            }
-            // found self (not opponent or empty), success
-            assert((player >> (index + (testX - x))) & 0b1);
-            success = true;
-
-            // take full strip, reduce to flipped length, shift to right of index
-            const uint64_t mask =
-                ((0b11111111ULL >> (BOARD_SIZE - ((x - testX)))) << (index - ((x - testX - 1))));
-            assert(mask);
-
-            // set player tiles
-            boards[move].player |= mask;
-            assert(boards[move].player & boards[move].opponent);
-
-            // clear opponent tiles
-            boards[move].opponent &= ~mask;
-            assert(!(boards[move].player & boards[move].opponent));
-
-            // add value of move
-            value += eval_right(boards[move].player, boards[move].opponent, x, y, x - testX - 1);
-            break;
-          }
-        }
-      }
+  // check if there are any moves
+  if (move != NO_MOVE) {
+    // add the move to the python list of moves
+    PyObject *pyTup = Py_BuildValue("(ii)", move % BOARD_SIZE, move / BOARD_SIZE);
+    PyList_Append(moves, pyTup);
+    Py_DECREF(pyTup);
+  }
 
-      // start at lowest (min y) index, move up (+Y)
-      if (y + 2 < BOARD_SIZE && up >> index & 0b1) {
-        // testY - y = number of tiles to flip (includes placed tile)
-        // (testY - y) * BOARD_SIZE = offset from index
-        for (int8_t testY = y + 2; testY < BOARD_SIZE; testY++) {
-          // if it's an opponent tile, just continue
-          if (!((opponent >> (index + (testY - y) * BOARD_SIZE)) & 0b1)) {
-            // empty tile, so fail
-            if ((empty >> (index + (testY - y) * BOARD_SIZE)) & 0b1) {
-              break;
-            }
-            // found self (not opponent or empty), success
-            assert((player >> (index + (testY - y) * BOARD_SIZE)) & 0b1);
-            success = true;
-
-            // take full '\' diagonal, reduce to flipped height, shift to index
-            const uint64_t mask =
-                ((0b0000000100000001000000010000000100000001000000010000000100000001ULL >>
-                  ((BOARD_SIZE - ((testY - y)))) * BOARD_SIZE)
-                 << index);
-            assert(mask);
-
-            // set player tiles
-            boards[move].player |= mask;
-            assert(boards[move].player & boards[move].opponent);
-
-            // clear opponent tiles
-            boards[move].opponent &= ~mask;
-            assert(!(boards[move].player & boards[move].opponent));
-
-            // add value of move
-            value += eval_up(boards[move].player, boards[move].opponent, x, y, testY - y - 1);
-            break;
-          }
-        }
-      }
+  // set the python dict values
+  PyDict_SetItemString(output, "moves", moves);
+  Py_DECREF(moves);
+  puts("End");
+  return output;
+}
 
-      // start at highest (max y) index, move down (-Y)
-      if (y >= 2 && down >> index & 0b1) {
-        // y - testY = number of tiles to flip (includes placed tile)
-        // (testY - y) * BOARD_SIZE = offset from index
-        for (int8_t testY = y - 1; testY >= 0; testY--) {
-          // if it's an opponent tile, just continue
-          if (!((opponent >> (index + (testY - y) * BOARD_SIZE)) & 0b1)) {
-            // empty tile, so fail
-            if ((empty >> (index + (testY - y) * BOARD_SIZE)) & 0b1) {
-              break;
-            }
-            // found self (not opponent or empty), success
-            assert((player >> (index + (testY - y) * BOARD_SIZE)) & 0b1);
-            success = true;
-
-            // take full '\' diagonal, reduce to flipped height, shift to index
-            const uint64_t mask =
-                ((0b0000000100000001000000010000000100000001000000010000000100000001ULL >>
-                  ((BOARD_SIZE - ((y - testY))) * BOARD_SIZE))
-                 << (index - (y - testY - 1) * BOARD_SIZE));
-            assert(mask);
-
-            // set player tiles
-            boards[move].player |= mask;
-            assert(boards[move].player & boards[move].opponent);
-
-            // clear opponent tiles
-            boards[move].opponent &= ~mask;
-            assert(!(boards[move].player & boards[move].opponent));
-
-            // add value of move
-            value += eval_down(boards[move].player, boards[move].opponent, x, y, y - testY - 1);
-            break;
-          }
-        }
-      }
+/**
+ * \brief generates a move for a board given as bitboards (bit y * 8 + x is the tile at x, y)
+ * \param self python module instance
+ * \param args function arguments from python: tiles of the player to move and the other, time
+ * \return the move to make as an (x, y) tuple, or None if there is none
+ */
+static PyObject *revai_ai_bitboards(PyObject *self, PyObject *args) {
+  unsigned long long ours;
+  unsigned long long theirs;
+  double time_s = 0;
+  if (!PyArg_ParseTuple(args, "KKd", &ours, &theirs, &time_s)) {
+    return NULL;
+  }
 
-      // TOP + RIGHT EDGE INVALID / bottom-left to top-right
-      if (y + 2 < BOARD_SIZE && x >= 2 && upRight >> index & 0b1) {
-        // testY - y, x - testX = number of tiles to flip (includes placed tile)
-        // (testY - y) * BOARD_SIZE, testX - x = offset from index
-        for (int8_t testY = y + 2, testX = x - 2; testY < BOARD_SIZE && testX >= 0;
-             testY++, testX--) {
-          // if it's an opponent tile, just continue
-          if (!((opponent >> (index + (testY - y) * BOARD_SIZE + (testX - x))) & 0b1)) {
-            // empty tile, so fail
-            if ((empty >> (index + (testY - y) * BOARD_SIZE + (testX - x))) & 0b1) {
-              break;
-            }
-            // found self (not opponent or empty), success
-            assert((player >> (index + (testY - y) * BOARD_SIZE + (testX - x))) & 0b1);
-            success = true;
-
-            // take mask of '/' diagonal, reduce to flipped height, shift to index
-            const uint64_t mask =
-                ((0b0000000100000010000001000000100000010000001000000100000010000000ULL >>
-                  (((BOARD_SIZE - ((testY - y))) * BOARD_SIZE)))
-                 << ((y)*BOARD_SIZE + (x - (testY - y - 1))));
-            assert(mask);
-
-            // set player tiles
-            boards[move].player |= mask;
-            assert(boards[move].player & boards[move].opponent);
-
-            // clear opponent tiles
-            boards[move].opponent &= ~mask;
-            assert(!(boards[move].player & boards[move].opponent));
-
-            // add value of move
-            value += eval_up_right(boards[move].player, boards[move].opponent, x, y, testY - y - 1);
-            break;
-          }
-        }
-      }
+  if (ours & theirs) {
+    PyErr_SetString(PyExc_ValueError, "the players' tiles overlap");
+    return NULL;
+  }
 
-      // BOTTOM + LEFT EDGE INVALID / top-right to bottom-left
-      if (y >= 2 && x + 2 < BOARD_SIZE && downLeft >> index & 0b1) {
-        // y - testY, testX - x = number of tiles to flip (includes placed tile)
-        // (testY - y) * BOARD_SIZE, testX - x = offset from index
-        for (int8_t testY = y - 2, testX = x + 2; testY >= 0 && testX < BOARD_SIZE;
-             testY--, testX++) {
-          // if it's an opponent tile, just continue
-          if (!((opponent >> (index + (testY - y) * BOARD_SIZE + (testX - x))) & 0b1)) {
-            // empty tile, so fail
-            if ((empty >> (index + (testY - y) * BOARD_SIZE + (testX - x))) & 0b1) {
-              break;
-            }
-            // found self (not opponent or empty), success
-            assert((player >> (index + (testY - y) * BOARD_SIZE + (testX - x))) & 0b1);
-            success = true;
-
-            // take mask of '/' diagonal, reduce to flipped height, shift to index
-            const uint64_t mask =
-                ((0b0000000100000010000001000000100000010000001000000100000010000000ULL
-                  << ((BOARD_SIZE - ((y - testY))) * BOARD_SIZE)) >>
-                 ((BOARD_SIZE - y - 1) * BOARD_SIZE + BOARD_SIZE - testX));
-            assert(mask);
-
-            // set player tiles
-            boards[move].player |= mask;
-            assert(boards[move].player & boards[move].opponent);
-
-            // clear opponent tiles
-            boards[move].opponent &= ~mask;
-            assert(!(boards[move].player & boards[move].opponent));
-
-            // add value of move
-            value +=
-                eval_down_left(boards[move].player, boards[move].opponent, x, y, y - testY - 1);
-            break;
-          }
-        }
-      }
+  if (!search_begin(self)) {
+    return NULL;
+  }
+  uint8_t move;
+  Py_BEGIN_ALLOW_THREADS
+  move = engine_move(ours, theirs, time_s);
+  Py_END_ALLOW_THREADS
+  search_end(self);
+  if (move == NO_MOVE) {
+    Py_RETURN_NONE;
+  }
+  return Py_BuildValue("(ii)", move % BOARD_SIZE, move / BOARD_SIZE);
+}
 
-      // TOP + LEFT EDGE INVALID / bottom-right to top-left
-      if (y + 2 < BOARD_SIZE && x + 2 < BOARD_SIZE && upLeft >> index & 0b1) {
-        // testY - y, testX - x = number of tiles to flip (includes placed tile)
-        // (testY - y) * BOARD_SIZE, testX - x = offset from index
-        for (int8_t testY = y + 2, testX = x + 2; testY < BOARD_SIZE && testX < BOARD_SIZE;
-             testY++, testX++) {
-          // if it's an opponent tile, just continue
-          if (!((opponent >> (index + (testY - y) * BOARD_SIZE + (testX - x))) & 0b1)) {
-            // empty tile, so fail
-            if ((empty >> (index + (testY - y) * BOARD_SIZE + (testX - x))) & 0b1) {
-              break;
-            }
-            // found self (not opponent or empty), success
-            assert((player >> (index + (testY - y) * BOARD_SIZE + (testX - x))) & 0b1);
-            success = true;
-
-            // take mask of '\' diagonal, reduce to flipped height, shift to index
-            const uint64_t mask =
-                ((0b1000000001000000001000000001000000001000000001000000001000000001ULL >>
-                  (((BOARD_SIZE - ((testY - y))) * BOARD_SIZE) + (BOARD_SIZE - ((testY - y)))))
-                 << index);
-            assert(mask);
-
-            // set player tiles
-            boards[move].player |= mask;
-            assert(boards[move].player & boards[move].opponent);
-
-            // clear opponent tiles
-            boards[move].opponent &= ~mask;
-            assert(!(boards[move].player & boards[move].opponent));
-
-            // add value of move
-            value += eval_up_left(boards[move].player, boards[move].opponent, x, y, testY - y - 1);
-            break;
-          }
-        }
-      }
+static PyObject *revai_reset(PyObject *self, PyObject *args) {
+  if (!check_idle(self)) {
+    return NULL;
+  }
+  engine_reset();
+  Py_RETURN_NONE;
+}
 
-      // BOTTOM + RIGHT EDGE INVALID / top-left to bottom-right
-      if (y >= 2 && x >= 2 && downRight >> index & 0b1) {
-        // y - testY, x - testX = number of tiles to flip (includes placed tile)
-        // (testY - y) * BOARD_SIZE, testX - x = offset from index
-        for (int8_t testY = y - 2, testX = x - 2; testY >= 0 && testX >= 0; testY--, testX--) {
-          // if it's an opponent tile, just continue
-          if (!((opponent >> (index + (testY - y) * BOARD_SIZE + (testX - x))) & 0b1)) {
-            // empty tile, so fail
-            if ((empty >> (index + (testY - y) * BOARD_SIZE + (testX - x))) & 0b1) {
-              break;
-            }
-            // found self (not opponent or empty), success
-            assert((player >> (index + (testY - y) * BOARD_SIZE + (testX - x))) & 0b1);
-            success = true;
-
-            // take mask of '\' diagonal, reduce to flipped height, shift to index
-            const uint64_t mask =
-                ((0b1000000001000000001000000001000000001000000001000000001000000001ULL
-                  << (((BOARD_SIZE - ((y - testY))) * BOARD_SIZE) + (BOARD_SIZE - (y - testY)))) >>
-                 ((BOARD_SIZE - y - 1) * BOARD_SIZE + (BOARD_SIZE - x - 1)));
-
-            // set player tiles
-            boards[move].player |= mask;
-            assert(boards[move].player & boards[move].opponent);
-
-            // clear opponent tiles
-            boards[move].opponent &= ~mask;
-            assert(!(boards[move].player & boards[move].opponent));
-
-            value +=
-                eval_down_right(boards[move].player, boards[move].opponent, x, y, y - testY - 1);
-            break;
-          }
-        }
-      }
+/**
+ * \brief resizes the transposition table (clearing it)
+ * \param self python module instance
+ * \param args function arguments from python: size in megabytes
+ */
+static PyObject *revai_set_hash_size(PyObject *self, PyObject *args) {
+  Py_ssize_t megabytes;
+  if (!PyArg_ParseTuple(args, "n", &megabytes)) {
+    return NULL;
+  }
 
-      // if the move was successful, add it to the list of moves
-      if (success) {
-        printf("^^^^^^ %i, %i (d=%i) ^^^^^^\n", x, y, depth);
-        print_board(boards[move].player, boards[move].opponent);
-
-        // set the position + value of the move
-        boards[move].x = x;
-        boards[move].y = y;
-        boards[move].value = value;
-
-        // prepare next board state
-        if (++move == 16) {
-          // https://jxiv.jst.go.jp/index.php/jxiv/preprint/download/480/1498/1315
-          boards = (BoardState*)realloc(boards, sizeof(BoardState) * 33);
-          assert(boards != NULL);
-        }
+  if (megabytes <= 0) {
+    PyErr_SetString(PyExc_ValueError, "hash size must be positive");
+    return NULL;
+  }
 
-        boards[move].nextStates = NULL;
-        boards[move].x = 0;
-        boards[move].y = 0;
-        boards[move].player = player;
-        boards[move].opponent = opponent;
-        boards[move].value = 0;
-        boards[move].worstBranch = 0;
-        boards[move].lenStates = -1;
-      }
+  if (!check_no_searches()) {
+    return NULL;
+  }
+  if (!engine_set_hash_size((size_t)megabytes)) {
+    return PyErr_NoMemory();
+  }
+  Py_RETURN_NONE;
+}
 
-      index++;
-    }
+/**
+ * \brief sets how many empty squares the endgame solver takes over at
+ * \param self python module instance
+ * \param args function arguments from python: number of empty squares (0 disables the solver)
+ */
+static PyObject *revai_set_endgame_empties(PyObject *self, PyObject *args) {
+  int empties;
+  if (!PyArg_ParseTuple(args, "i", &empties)) {
+    return NULL;
   }
 
-  // check if moves were found
-  if (move != 0) {
-    boards = (BoardState*)realloc(boards, sizeof(BoardState) * move);
-    assert(boards != NULL);
-  } else {
-    free(boards);
-    boards = NULL;
+  if (empties < 0 || empties > BOARD_SIZE * BOARD_SIZE) {
+    PyErr_SetString(PyExc_ValueError, "empty squares must be between 0 and 64");
+    return NULL;
   }
 
-  state->nextStates = boards;
-  state->lenStates = move;
-  assert(state->lenStates != -1);
+  if (!check_idle(self)) {
+    return NULL;
+  }
+  engine_set_endgame_empties(empties);
+  Py_RETURN_NONE;
 }
 
-void recalculate_move_values(BoardState *state, const uint8_t depth) {
-  assert(!(state->player & state->opponent));
-
-  if (state->lenStates > 0) {
-    if (depth < maxDepth) {
-      int16_t max = INT16_MIN;
+/**
+ * \brief maps an opening book, replacing the current one
+ * \param self python module instance
+ * \param args function arguments from python: path of the book
+ */
+static PyObject *revai_load_book(PyObject *self, PyObject *args) {
+  const char *path;
+  if (!PyArg_ParseTuple(args, "s", &path)) {
+    return NULL;
+  }
 
-      // serially iterate over all possible moves
-      for (int i = 0; i < state->lenStates; ++i) {
-        recalculate_move_values(&state->nextStates[i], depth + 1);
-        const int16_t realVal = state->nextStates[i].value - state->nextStates[i].worstBranch;
-        max = realVal > max ? realVal : max;
-      }
-      state->worstBranch = max;
-    }
-  } else {
-    // check if ending the game is beneficial
-    if (_popcnt64(state->player) < _popcnt64(state->opponent)) {
-      // we lose, so set the worst branch to the worst possible value
-      state->value = 0;
-      state->worstBranch = INT16_MAX / 8;
-    } else if (_popcnt64(state->player) > _popcnt64(state->opponent)) {
-      // we win, so set the worst branch to the best possible value
-      state->value = 0;
-      state->worstBranch = INT16_MIN / 8;
-    } else {
-      // tie, so set the worst branch to 0
-      state->value = 0;
-      state->worstBranch = -10;
-    }
+  if (!check_no_searches()) {
+    return NULL;
+  }
+  const int64_t count = engine_load_book(path);
+  if (count < 0) {
+    PyErr_Format(PyExc_OSError, "could not load opening book %s", path);
+    return NULL;
   }
+  return PyLong_FromLongLong(count);
 }
 
-void search_for_moves_serial(BoardState *state, int16_t alpha, int16_t beta, const uint8_t depth) {
-  assert(!(state->player & state->opponent));
-
-  if (state->lenStates == -1) {
-    generate_child_moves(state);
+/**
+ * \brief builds an opening book, resetting the current game
+ * \param self python module instance
+ * \param args function arguments from python: path to write to, plies from the start, search depth
+ * \return the number of boards in the book
+ */
+static PyObject *revai_build_book(PyObject *self, PyObject *args) {
+  const char *path;
+  int plies;
+  int depth;
+  if (!PyArg_ParseTuple(args, "sii", &path, &plies, &depth)) {
+    return NULL;
   }
 
-  if (state->lenStates > 0) {
-    if (depth < maxDepth) {
-      int16_t max = INT16_MIN;
+  if (plies < 0 || depth < 1 || depth > BOARD_SIZE * BOARD_SIZE) {
+    PyErr_SetString(PyExc_ValueError, "plies must be at least 0 and depth between 1 and 64");
+    return NULL;
+  }
 
-      visited += state->lenStates;
-      if (visited > MOVE_CUTOFF) {
-        maxDepth = depth;
-        return;
-      }
-      // serially iterate over all possible moves
-      for (int i = 0; i < state->lenStates; ++i) {
-        search_for_moves_serial(&state->nextStates[i], beta, alpha, depth + 1);
-        const int16_t realVal = state->nextStates[i].value - state->nextStates[i].worstBranch;
-        max = realVal > max ? realVal : max;
-        alpha = alpha > max ? alpha : max;
-
-        if (beta != INT16_MIN && max > beta) {
-          break;
-        }
-      }
-      state->worstBranch = max;
-    }
-  } else {
-    // check if ending the game is beneficial
-    if (_popcnt64(state->player) < _popcnt64(state->opponent)) {
-      // we lose, so set the worst branch to the worst possible value
-      state->value = 0;
-      state->worstBranch = INT16_MAX / 8;
-    } else if (_popcnt64(state->player) > _popcnt64(state->opponent)) {
-      // we win, so set the worst branch to the best possible value
-      state->value = 0;
-      state->worstBranch = INT16_MIN / 8;
-    } else {
-      // tie, so set the worst branch to 0
-      state->value = 0;
-      state->worstBranch = -10;
-    }
+  if (!search_begin(self)) {
+    return NULL;
   }
+  int64_t count;
+  Py_BEGIN_ALLOW_THREADS
+  count = engine_build_book(path, plies, depth);
+  Py_END_ALLOW_THREADS
+  search_end(self);
+  if (count < 0) {
+    PyErr_Format(PyExc_OSError, "could not build opening book %s", path);
+    return NULL;
+  }
+  return PyLong_FromLongLong(count);
 }
 
-struct ThreadArgs {
-  BoardState *state;
-  int16_t alpha;
-  int16_t beta;
-  uint8_t depth;
-};
+/**
+ * \brief starts or stops recording every searched position with its score
+ * \param self python module instance
+ * \param args function arguments from python: path of the record file, or None to stop
+ */
+static PyObject *revai_record_positions(PyObject *self, PyObject *args) {
+  const char *path;
+  if (!PyArg_ParseTuple(args, "z", &path)) {
+    return NULL;
+  }
 
-int search_for_move_thread_cb(void *args) {
-  const struct ThreadArgs *thread_args = args;
-  search_for_moves_serial(thread_args->state, thread_args->alpha, thread_args->beta, thread_args->depth);
-  return 0;
+  if (path == NULL) {
+    engine_record_close();
+  } else if (!engine_record_open(path)) {
+    PyErr_Format(PyExc_OSError, "could not open record file %s", path);
+    return NULL;
+  }
+  Py_RETURN_NONE;
 }
 
-void search_for_moves_paralell(BoardState *state, int16_t alpha, int16_t beta, const uint8_t depth, const int8_t parDepth) {
-  assert(!(state->player & state->opponent));
-
-  if (state->lenStates == -1) {
-    generate_child_moves(state);
+/**
+ * \brief sets how many plies below the current board the search tree keeps
+ * \param self python module instance
+ * \param args function arguments from python: number of plies (0 keeps every ply)
+ */
+static PyObject *revai_set_tree_plies(PyObject *self, PyObject *args) {
+  int plies;
+  if (!PyArg_ParseTuple(args, "i", &plies)) {
+    return NULL;
   }
 
-  if (state->lenStates > 0) {
-    if (depth < maxDepth) {
-      int16_t worst = INT16_MIN;
+  if (plies < 0 || plies > BOARD_SIZE * BOARD_SIZE) {
+    PyErr_SetString(PyExc_ValueError, "plies must be between 0 and 64");
+    return NULL;
+  }
 
-      if (parDepth == depth) {
-        thrd_t *threads = malloc(sizeof(thrd_t) * state->lenStates);
+  if (!check_idle(self)) {
+    return NULL;
+  }
+  if (!engine_set_tree_plies(plies)) {
+    return PyErr_NoMemory();
+  }
+  Py_RETURN_NONE;
+}
 
-        // paralelly iterate over all possible moves
-        visited += state->lenStates;
-        if (visited > MOVE_CUTOFF) {
-          maxDepth = depth;
-          return;
-        }
-        for (int i = 0; i < state->lenStates; ++i) {
-          thrd_create(&threads[i], search_for_move_thread_cb, &(struct ThreadArgs) {.state = &state->nextStates[i], .beta = beta, .alpha = alpha, .depth = (uint8_t)depth + 1 });
-        }
+/**
+ * \brief sets how far past the search window a shallow search has to be for ProbCut to prune a
+ * subtree
+ * \param self python module instance
+ * \param args function arguments from python: phase of the game (tiles on the board / 16, from 0 to
+ * 3), margin in evaluation units (0 disables ProbCut in the phase)
+ */
+static PyObject *revai_set_probcut(PyObject *self, PyObject *args) {
+  int phase;
+  int margin;
+  if (!PyArg_ParseTuple(args, "ii", &phase, &margin)) {
+    return NULL;
+  }
 
-        for (int i = 0; i < state->lenStates; ++i) {
-          if (thrd_join(threads[i], NULL) != thrd_success) {
-            fputs("FAIL\n", stdout);
-          }
-        }
+  if (phase < 0 || phase >= PROBCUT_PHASES || margin < 0) {
+    PyErr_SetString(PyExc_ValueError, "phase must be between 0 and 3 and margin at least 0");
+    return NULL;
+  }
 
-        free(threads);
+  if (!check_idle(self)) {
+    return NULL;
+  }
+  engine_set_probcut(phase, margin);
+  Py_RETURN_NONE;
+}
 
-        for (int i = 0; i < state->lenStates; i++) {
-          const int16_t realVal = state->nextStates[i].value - state->nextStates[i].worstBranch;
-          worst = max(realVal, worst);
-          alpha = max(alpha, worst);
-        }
-      } else {
-        // serially iterate over all possible moves
-        visited += state->lenStates;
-        if (visited > MOVE_CUTOFF) {
-          maxDepth = depth;
-          return;
-        }
-        for (int i = 0; i < state->lenStates; ++i) {
-          search_for_moves_paralell(&state->nextStates[i], beta, alpha, depth + 1, parDepth);
-          const int16_t realVal = state->nextStates[i].value - state->nextStates[i].worstBranch;
-          worst = realVal > worst ? realVal : worst;
-          alpha = alpha > worst ? alpha : worst;
-
-          if (beta != INT16_MIN && worst > beta) {
-            break;
-          }
-        }
-      }
+/**
+ * \brief sets how the search is spread between the search threads
+ * \param self python module instance
+ * \param args function arguments from python: "split" (split subtrees between the threads) or
+ * "lazy" (lazy smp, the threads share the transposition table)
+ */
+static PyObject *revai_set_search_mode(PyObject *self, PyObject *args) {
+  const char *mode;
+  if (!PyArg_ParseTuple(args, "s", &mode)) {
+    return NULL;
+  }
 
-      state->worstBranch = worst;
-    }
-  } else {
-    // check if ending the game is beneficial
-    if (_popcnt64(state->player) < _popcnt64(state->opponent)) {
-      // we lose, so set the worst branch to the worst possible value
-      state->value = 0;
-      state->worstBranch = INT16_MAX / 8;
-    } else if (_popcnt64(state->player) > _popcnt64(state->opponent)) {
-      // we win, so set the worst branch to the best possible value
-      state->value = 0;
-      state->worstBranch = INT16_MIN / 8;
-    } else {
-      // tie, so set the worst branch to 0
-      state->value = 0;
-      state->worstBranch = -10;
-    }
+  if (!check_idle(self)) {
+    return NULL;
   }
-#ifdef DEBUG_LOG
-  if (depth == 0) {
-    fprintf(stdout,
-            "%i:%i [n=%i,t=%i,d=%i]: %i\n",
-            static_cast<int>(__popcntq(head.player)),
-            static_cast<int>(__popcntq(head.opponent)),
-            head.lenStates,
-            placedTiles,
-            maxDepth,
-            state->worstBranch);
+  if (strcmp(mode, "split") == 0) {
+    engine_set_search_mode(SEARCH_SPLIT);
+  } else if (strcmp(mode, "lazy") == 0) {
+    engine_set_search_mode(SEARCH_LAZY);
+  } else {
+    PyErr_SetString(PyExc_ValueError, "mode must be \"split\" or \"lazy\"");
+    return NULL;
   }
-#endif
+  Py_RETURN_NONE;
 }
 
 /**
- * \brief frees all the children of a board state
- * \param state the board state to free
- * \note DOES NOT free the state itself (assumes its a child in an array)
+ * \brief enables or disables searching on the opponent's time
+ * \param self python module instance
+ * \param args function arguments from python: whether to ponder
  */
-static void node_free(BoardState *state, int exclude) {
-  for (int i = 0; i < state->lenStates; ++i) {
-    if (i == exclude) continue;
-    node_free(&state->nextStates[i], -1);
+static PyObject *revai_set_ponder(PyObject *self, PyObject *args) {
+  int enabled;
+  if (!PyArg_ParseTuple(args, "p", &enabled)) {
+    return NULL;
   }
 
-  if (state->nextStates != NULL) {
-    free(state->nextStates);
-    state->nextStates = NULL;
+  if (!check_idle(self)) {
+    return NULL;
   }
-  state->lenStates = -1;
+  engine_set_ponder(enabled);
+  Py_RETURN_NONE;
 }
 
 /**
- * \brief generates a move for the current board state
+ * \brief finds the best moves of many boards at once, using every search thread
  * \param self python module instance
- * \param args function arguments from python: board, player, time
- * \return the move to make in a python dict -> list -> tuple
+ * \param args function arguments from python: a sequence of (player to move, other player)
+ * bitboards, search depth and optionally a node limit per board (0 for none)
+ * \return a list of (move, score) tuples, the move is an (x, y) tuple or None if there is none
+ * \note boards within the endgame solver's reach are solved when the depth allows and there is no
+ * node limit
  */
-static PyObject *revai_ai(PyObject *self, PyObject *args) {
-  puts("Start");
-
-  // parse arguments
-  PyObject *pyBoard;
-  PyObject *pyPlayer;
-  int64_t time_s = 0;
-  PyArg_ParseTuple(args, "OOk", &pyBoard, &pyPlayer, &time_s);
-
-  // check if the board is empty (first move)
-  if ((head.player | head.opponent) == 0) {
-    // get the board state from the python game
-    placedTiles = 0;
-    uint8_t index = 0;
-    for (uint8_t y = 0; y < BOARD_SIZE; y++) {
-      PyObject *pyRow = PyList_GetItem(pyBoard, y);
-      for (uint8_t x = 0; x < BOARD_SIZE; x++, index++) {
-        PyObject *pyItem = PyList_GetItem(pyRow, x);
-        // if the tile is not a tuple it is a player tile
-        if (!PyTuple_Check(pyItem)) {
-          // check if the tile is ours
-          // we're generating the previous move's state, so we swap player/opponent
-          if (PyObject_RichCompareBool(pyItem, pyPlayer, Py_EQ)) {
-            head.opponent |= 1ULL << index;
-          } else {
-            head.player |= 1ULL << index;
-          }
-
-          placedTiles++;
-        }
-      }
-    }
-
-    head.value = 0;
-  } else {
-    // find the move that was made
-    for (int i = 0; i < head.lenStates; ++i) {
-      const BoardState nxt = head.nextStates[i];
-
-      // unpack the position of the move
-      const uint8_t x = nxt.x;
-      const uint8_t y = nxt.y;
-
-      // check if the tile at the position (python) is not empty (tuple)
-      if (!PyObject_IsInstance(PyList_GetItem(PyList_GetItem(pyBoard, y), x), (PyObject *)&PyTuple_Type)) {
-        printf("Opponent: %i, %i\n", x, y);
-
-        // free all the other moves
-        node_free(&head, i);
-
-        puts("OPP BEFORE");
-        print_board(head.player, head.opponent);
-        puts("OPP AFTER");
-        print_board(nxt.opponent, nxt.player);
-
-        // set the new board state and increment the move count
-        head = nxt;
-        placedTiles++;
-
-#ifdef DEBUG_LOG
-        fprintf(stdout, "%i:%i Opponent [t=%i]: %i\n",
-                static_cast<int>(__popcntq(head.player)),
-                static_cast<int>(__popcntq(head.opponent)), placedTiles, head.value - head.worstBranch);
-#endif
-        break;
-      }
-    }
+static PyObject *revai_analyze(PyObject *self, PyObject *args) {
+  PyObject *pyBoards;
+  int depth;
+  unsigned long long nodeLimit = 0;
+  if (!PyArg_ParseTuple(args, "Oi|K", &pyBoards, &depth, &nodeLimit)) {
+    return NULL;
   }
 
-  // calculate the maximum depth to search based on the number of tiles placed
-  placedTiles++;
-  maxDepth = placedTiles < 25 ? 3
-             : placedTiles < 30 ? 5
-             : placedTiles < 35 ? 6
-             : placedTiles < 40 ? 7
-             : placedTiles < 45 ? 7
-             : placedTiles < 50 ? 7
-                                : 8;
-
-  SYSTEMTIME time;
-  GetSystemTime(&time);
-  visited = 0;
-  const int rmd = maxDepth;
-  // calculate the best possible move
-  if (maxDepth == 5) {
-    search_for_moves_paralell(&head, INT16_MIN, INT16_MIN, 0, 1);
-  } else if (maxDepth == 6) {
-    search_for_moves_paralell(&head, INT16_MIN, INT16_MIN, 0, 3);
-  } else if (maxDepth == 7) {
-    search_for_moves_paralell(&head, INT16_MIN, INT16_MIN, 0, 3);
-  }  else if (maxDepth == 8) {
-    search_for_moves_paralell(&head, INT16_MIN, INT16_MIN, 0, 4);
-  } else {
-    // otherwise search serially
-    search_for_moves_serial(&head, INT16_MIN, INT16_MIN, 0);
+  if (depth < 1 || depth > BOARD_SIZE * BOARD_SIZE) {
+    PyErr_SetString(PyExc_ValueError, "depth must be between 1 and 64");
+    return NULL;
   }
 
-  SYSTEMTIME time2;
-  GetSystemTime(&time2);
-  uint64_t duration =
-      (time2.wDay - time.wDay) * 24 * 60 * 1000ULL + (time2.wMinute - time.wMinute) * 60 * 1000ULL +
-      (time2.wSecond - time.wSecond) * 1000ULL + time2.wMilliseconds - time.wMilliseconds;
-  fprintf(stdout, "Move took: %llums\n", duration);
-  // if (duration > 1000) {
-  //   for (int i = 0; i < maxDepth; i++) {
-  //     fprintf(stdout, "D%i: %i\n", i, depthSize[i]);
-  //   }
-  // }
-
-  if (rmd != maxDepth) {
-    fputs("rmv\n", stdout);
-    recalculate_move_values(&head, 0);
-    fputs("Prmv\n", stdout);
+  PyObject *boards = PySequence_Fast(pyBoards, "boards must be a sequence");
+  if (boards == NULL) {
+    return NULL;
   }
 
-  // create the python dict to return
-  PyObject *output = PyDict_New();
-  // create the python list of moves
-  PyObject *moves = PyList_New(0);
+  const Py_ssize_t count = PySequence_Fast_GET_SIZE(boards);
+  Analysis *analyses = malloc(sizeof(Analysis) * (size_t)(count > 0 ? count : 1));
+  if (analyses == NULL) {
+    Py_DECREF(boards);
+    return PyErr_NoMemory();
+  }
 
-  // find the best move from all the possible moves
-  int8_t *bestMoves = malloc(sizeof(int8_t) * head.lenStates);
-  int8_t idx = 0;
-  // the value of the best move
-  int16_t best = INT16_MIN;
-
-  // iterate over all possible moves
-  for (int8_t i = 0; i < head.lenStates; ++i) {
-    const int16_t realVal = head.nextStates[i].value - head.nextStates[i].worstBranch;
-    // if the move is better than the current best, reset the list of best moves
-    if (realVal > best) {
-      best = realVal;
-      idx = 0;
-      bestMoves[idx++] = i;
-    } else if (realVal == best) {
-      // otherwise append the move to the list of best moves
-      bestMoves[idx++] = i;
+  for (Py_ssize_t i = 0; i < count; ++i) {
+    unsigned long long player;
+    unsigned long long opponent;
+    PyObject *pyBoard = PySequence_Fast_GET_ITEM(boards, i);
+    if (!PyArg_ParseTuple(
+            pyBoard, "KK;boards must be (player, opponent) tuples", &player, &opponent)) {
+      free(analyses);
+      Py_DECREF(boards);
+      return NULL;
+    }
+    if (player & opponent) {
+      PyErr_Format(PyExc_ValueError, "the players' tiles overlap in board %zd", i);
+      free(analyses);
+      Py_DECREF(boards);
+      return NULL;
     }
+    analyses[i] = (Analysis){.player = player,
+        .opponent = opponent,
+        .depth = depth,
+        .nodeLimit = nodeLimit,
+        .timeLimit = 0,
+        .evaluator = NULL};
   }
+  Py_DECREF(boards);
 
-  // check if there are any moves
-  if (idx > 0) {
-    // if there are multiple best moves, pick one at random
-    const int8_t best_move = bestMoves[rand() % idx];
+  if (!search_begin(self)) {
+    free(analyses);
+    return NULL;
+  }
+  bool analyzed;
+  Py_BEGIN_ALLOW_THREADS
+  analyzed = engine_analyze(analyses, (size_t)count);
+  Py_END_ALLOW_THREADS
+  search_end(self);
+  if (!analyzed) {
+    free(analyses);
+    return PyErr_NoMemory();
+  }
 
-    // unpack the move value
-    const BoardState next_state = head.nextStates[best_move];
-    const uint8_t x = next_state.x;
-    const uint8_t y = next_state.y;
+  PyObject *output = PyList_New(count);
+  for (Py_ssize_t i = 0; output != NULL && i < count; ++i) {
+    PyObject *result;
+    if (analyses[i].move == NO_MOVE) {
+      result = Py_BuildValue("(Oi)", Py_None, analyses[i].score);
+    } else {
+      result = Py_BuildValue("((ii)i)",
+          analyses[i].move % BOARD_SIZE,
+          analyses[i].move / BOARD_SIZE,
+          analyses[i].score);
+    }
+    if (result == NULL) {
+      Py_CLEAR(output);
+      break;
+    }
+    PyList_SET_ITEM(output, i, result);
+  }
+  free(analyses);
+  return output;
+}
 
-    // add the move to the python list of moves
-    PyObject *pyX = PyLong_FromLong(x);
-    PyObject *pyY = PyLong_FromLong(y);
-    PyObject *pyTup = PyTuple_Pack(2, pyX, pyY);
-    PyList_Append(moves, pyTup);
+/**
+ * \brief gets the statistics of the last move's search
+ * \param self python module instance
+ * \param args no arguments
+ * \return a dict of the nodes (in total and by iteration), effective branching factor, cutoffs,
+ * ProbCut prunes, transposition table probes / hits, completed depth, time (s) and what stopped or
+ * replaced the search
+ */
+static PyObject *revai_stats(PyObject *self, PyObject *args) {
+  if (!check_idle(self)) {
+    return NULL;
+  }
+  EngineStats stats;
+  engine_stats(&stats);
 
-    // decrement the reference count of the python objects
-    Py_DECREF(pyX);
-    Py_DECREF(pyY);
-    Py_DECREF(pyTup);
+  PyObject *depthNodes = PyList_New(stats.iterations);
+  if (depthNodes == NULL) {
+    return NULL;
+  }
+  for (int i = 0; i < stats.iterations; ++i) {
+    PyList_SET_ITEM(depthNodes, i, PyLong_FromUnsignedLongLong(stats.depthNodes[i]));
+  }
 
-    assert(!(head.player & head.opponent));
-    assert(!(next_state.player & next_state.opponent));
-    printf("before (%i, %i) - Possbile moves %i/%i (max %i)\n",
-           x,
-           y,
-           idx,
-           head.lenStates,
-           head.worstBranch);
-    print_board(head.player, head.opponent);
-    puts("after");
-    print_board(next_state.opponent, next_state.player);
+  // how many times more nodes the last completed iteration took than the one before it
+  PyObject *branching;
+  if (!stats.solved && stats.depth >= 2 && stats.depthNodes[stats.depth - 2] > 0) {
+    branching = PyFloat_FromDouble(
+        (double)stats.depthNodes[stats.depth - 1] / stats.depthNodes[stats.depth - 2]);
+  } else {
+    Py_INCREF(Py_None);
+    branching = Py_None;
+  }
 
-    node_free(&head, best_move);
+  return Py_BuildValue("{s:K,s:N,s:N,s:K,s:K,s:K,s:K,s:d,s:i,s:i,s:i,s:d,s:O,s:O,s:O}",
+      "nodes",
+      (unsigned long long)stats.nodes,
+      "depth_nodes",
+      depthNodes,
+      "branching_factor",
+      branching,
+      "cutoffs",
+      (unsigned long long)stats.cutoffs,
+      "probcuts",
+      (unsigned long long)stats.probcuts,
+      "table_probes",
+      (unsigned long long)stats.tableProbes,
+      "table_hits",
+      (unsigned long long)stats.tableHits,
+      "table_hit_rate",
+      stats.tableProbes > 0 ? (double)stats.tableHits / stats.tableProbes : 0.0,
+      "researches",
+      stats.researches,
+      "ponder_depth",
+      stats.ponderDepth,
+      "depth",
+      stats.depth,
+      "time",
+      stats.time / 1e6,
+      "node_limit_hit",
+      stats.nodeLimitHit ? Py_True : Py_False,
+      "solved",
+      stats.solved ? Py_True : Py_False,
+      "book",
+      stats.book ? Py_True : Py_False);
+}
 
-    // set the new board state
-    head = next_state;
+static PyObject *engine_object_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+  if (!PyArg_ParseTuple(args, ":Engine") || (kwargs != NULL && PyDict_Size(kwargs) > 0)) {
+    PyErr_SetString(PyExc_TypeError, "Engine takes no arguments");
+    return NULL;
   }
 
-  // free the list of best moves
-  free(bestMoves);
+  EngineObject *self = (EngineObject *)type->tp_alloc(type, 0);
+  if (self == NULL) {
+    return NULL;
+  }
+  self->engine = engine_create();
+  if (self->engine == NULL) {
+    Py_DECREF(self);
+    return PyErr_NoMemory();
+  }
+  return (PyObject *)self;
+}
 
-  // set the python dict values
-  PyDict_SetItemString(output, "moves", moves);
-  Py_DECREF(moves);
-  puts("End");
-  return output;
+static void engine_object_dealloc(EngineObject *self) {
+  engine_destroy(self->engine);
+  Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
-static PyObject *revai_reset(PyObject *self, PyObject *args) {
-  placedTiles = 0;
-  node_free(&head, -1);
-  head.nextStates = NULL;
-  head.value = 0;
-  head.player = 0;
-  head.opponent = 0;
-  head.worstBranch = 0;
-  head.x = 0;
-  head.y = 0;
-  head.lenStates = -1;
+// defines a method of Engine that runs a module function with the engine selected, so it plays (or
+// changes the settings of) the engine's game instead of the module's
+#define ENGINE_METHOD(function)                                               \
+  static PyObject *engine_object_##function(PyObject *self, PyObject *args) { \
+    engine_select(((EngineObject *)self)->engine);                           \
+    PyObject *result = revai_##function(self, args);                         \
+    engine_select(NULL);                                                     \
+    return result;                                                           \
+  }
 
-  Py_RETURN_NONE;
-}
+ENGINE_METHOD(ai)
+ENGINE_METHOD(ai_bitboards)
+ENGINE_METHOD(reset)
+ENGINE_METHOD(set_endgame_empties)
+ENGINE_METHOD(set_tree_plies)
+ENGINE_METHOD(set_probcut)
+ENGINE_METHOD(set_search_mode)
+ENGINE_METHOD(set_ponder)
+ENGINE_METHOD(stats)
+
+static PyMethodDef EngineMethods[] = {
+    {"ai_moves", engine_object_ai, METH_VARARGS, "AI."},
+    {"ai_move_bitboards",
+        engine_object_ai_bitboards,
+        METH_VARARGS,
+        "AI, with the board as bitboards."},
+    {"reset", engine_object_reset, METH_NOARGS, "Reset."},
+    {"set_endgame_empties",
+        engine_object_set_endgame_empties,
+        METH_VARARGS,
+        "Set the empty squares the endgame solver takes over at."},
+    {"set_tree_plies",
+        engine_object_set_tree_plies,
+        METH_VARARGS,
+        "Set the plies the search tree keeps."},
+    {"set_probcut",
+        engine_object_set_probcut,
+        METH_VARARGS,
+        "Set the ProbCut margin of a game phase."},
+    {"set_search_mode",
+        engine_object_set_search_mode,
+        METH_VARARGS,
+        "Split subtrees or use lazy SMP."},
+    {"set_ponder", engine_object_set_ponder, METH_VARARGS, "Search on the opponent's time."},
+    {"stats", engine_object_stats, METH_NOARGS, "Statistics of the last move's search."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject EngineType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "revai.Engine",
+    .tp_doc = "A game of its own, the module functions play the default one.",
+    .tp_basicsize = sizeof(EngineObject),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = engine_object_new,
+    .tp_dealloc = (destructor)engine_object_dealloc,
+    .tp_methods = EngineMethods,
+};
 
 static PyMethodDef RevaiMethods[] = {
     {"ai_moves", revai_ai, METH_VARARGS, "AI."},
+    {"ai_move_bitboards", revai_ai_bitboards, METH_VARARGS, "AI, with the board as bitboards."},
     {"reset", revai_reset, METH_NOARGS, "Reset."},
+    {"set_hash_size", revai_set_hash_size, METH_VARARGS, "Resize the transposition table (MB)."},
+    {"set_endgame_empties",
+        revai_set_endgame_empties,
+        METH_VARARGS,
+        "Set the empty squares the endgame solver takes over at."},
+    {"load_book", revai_load_book, METH_VARARGS, "Map an opening book file."},
+    {"build_book", revai_build_book, METH_VARARGS, "Build an opening book file."},
+    {"record_positions",
+        revai_record_positions,
+        METH_VARARGS,
+        "Append searched positions to a record file (None stops)."},
+    {"set_tree_plies", revai_set_tree_plies, METH_VARARGS, "Set the plies the search tree keeps."},
+    {"set_probcut", revai_set_probcut, METH_VARARGS, "Set the ProbCut margin of a game phase."},
+    {"set_search_mode", revai_set_search_mode, METH_VARARGS, "Split subtrees or use lazy SMP."},
+    {"set_ponder", revai_set_ponder, METH_VARARGS, "Search on the opponent's time."},
+    {"analyze", revai_analyze, METH_VARARGS, "Find the best moves of many boards."},
+    {"stats", revai_stats, METH_NOARGS, "Statistics of the last move's search."},
     {NULL, NULL, 0, NULL}
 };
 
 static PyModuleDef revaimodule = {PyModuleDef_HEAD_INIT, "revai", NULL, -1, RevaiMethods};
 
 PyMODINIT_FUNC PyInit_revai(void) {
-  srand(time(NULL));
-  return PyModule_Create(&revaimodule);
+  if (!engine_init(0)) {
+    PyErr_SetString(PyExc_RuntimeError, "failed to start the engine (out of memory or threads)");
+    return NULL;
+  }
+
+  // the last records are still buffered until the recording closes
+  Py_AtExit(engine_record_close);
+
+  const char *bookPath = getenv("HAMMER_BOOK");
+  if (bookPath != NULL && engine_load_book(bookPath) < 0) {
+    fprintf(stderr, "could not load opening book %s\n", bookPath);
+  }
+
+  if (PyType_Ready(&EngineType) < 0) {
+    return NULL;
+  }
+  PyObject *module = PyModule_Create(&revaimodule);
+  if (module == NULL) {
+    return NULL;
+  }
+  Py_INCREF(&EngineType);
+  if (PyModule_AddObject(module, "Engine", (PyObject *)&EngineType) < 0) {
+    Py_DECREF(&EngineType);
+    Py_DECREF(module);
+    return NULL;
+  }
+  return module;
 }
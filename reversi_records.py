@@ -0,0 +1,70 @@
+import mmap
+import struct
+from collections import namedtuple
+
+# matches RecordHeader and PositionRecord in engine.h (native byte order)
+RECORD_MAGIC = 0x4E534F50524D4148
+RECORD_VERSION = 1
+RECORD_SOLVED = 1
+HEADER = struct.Struct("=QII")
+RECORD = struct.Struct("=QQhBB4x")
+
+Record = namedtuple("Record", ["player", "opponent", "score", "depth", "solved"])
+
+
+def _record(player, opponent, score, depth, flags):
+    return Record(player, opponent, score, depth, bool(flags & RECORD_SOLVED))
+
+
+class Records:
+    """A position record file written by the engine, mapped into memory.
+
+    Each record is the bitboards of the player to move and the other player, the score of the
+    position for the player to move (the final disc differential if solved) and the plies searched.
+    """
+
+    def __init__(self, path):
+        with open(path, "rb") as file:
+            self._map = mmap.mmap(file.fileno(), 0, access=mmap.ACCESS_READ)
+        if len(self._map) < HEADER.size:
+            self.close()
+            raise ValueError(f"{path} is not a record file")
+        magic, version, size = HEADER.unpack_from(self._map)
+        if magic != RECORD_MAGIC or version != RECORD_VERSION or size != RECORD.size:
+            self.close()
+            raise ValueError(f"{path} is not a record file")
+        # a record cut off by a crash is ignored
+        self._count = (len(self._map) - HEADER.size) // RECORD.size
+
+    def __len__(self):
+        return self._count
+
+    def __getitem__(self, index):
+        if index < 0:
+            index += self._count
+        if not 0 <= index < self._count:
+            raise IndexError("record index out of range")
+        return _record(*RECORD.unpack_from(self._map, HEADER.size + index * RECORD.size))
+
+    def __iter__(self):
+        end = HEADER.size + self._count * RECORD.size
+        for fields in RECORD.iter_unpack(memoryview(self._map)[HEADER.size:end]):
+            yield _record(*fields)
+
+    def numpy(self):
+        """Returns the records as a numpy structured array, without copying them (the file can't be
+        closed while it is in use)."""
+        import numpy as np
+
+        dtype = np.dtype([("player", "=u8"), ("opponent", "=u8"), ("score", "=i2"),
+                          ("depth", "u1"), ("flags", "u1"), ("reserved", "V4")])
+        return np.frombuffer(self._map, dtype=dtype, count=self._count, offset=HEADER.size)
+
+    def close(self):
+        self._map.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
@@ -0,0 +1,447 @@
+/**
+ * Hammer: A Reversi Minimax AI
+ * Copyright (C) 2024 marcus8448
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// plays games between two engine configurations without python, see usage()
+
+#include "engine.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define popcount(x) ((int)__popcnt64(x))
+#define ctz(x) ((int)_tzcnt_u64(x))
+#else
+#define popcount(x) __builtin_popcountll(x)
+#define ctz(x) __builtin_ctzll(x)
+#endif
+
+/**
+ * \brief how one side plays
+ */
+typedef struct Config {
+  // the deepest iteration of each move, 0 for no limit
+  int depth;
+  // milliseconds on the side's clock for the whole game, 0 for no clock
+  uint32_t clock;
+  bool ponder;
+  bool lazy;
+  EvalWeights weights;
+  Evaluator *evaluator;
+} Config;
+
+/**
+ * \brief totals of the moves one side made
+ */
+typedef struct Stats {
+  uint64_t moves;
+  uint64_t nodes;
+  // microseconds
+  uint64_t time;
+  uint64_t maxTime;
+  // games lost on time
+  int timeouts;
+} Stats;
+
+/**
+ * \brief the board a game starts from
+ */
+typedef struct Opening {
+  // tiles of the side to move, and of the other side
+  uint64_t player;
+  uint64_t opponent;
+  // the configuration (0 or 1) of the side to move
+  int side;
+} Opening;
+
+/**
+ * \brief the games one thread plays, and what came of them
+ */
+typedef struct Worker {
+  thrd_t thread;
+  // wins, draws and losses of the first configuration
+  int results[3];
+  // the first configuration's total disc differential of the games finished on the board
+  long long discs;
+  int finished;
+  Stats stats[2];
+  bool failed;
+} Worker;
+
+static Config configs[2];
+static const Opening *openings;
+static int games;
+// the next game to play
+static atomic_int nextGame;
+
+static void usage(const char *name) {
+  fprintf(stderr,
+      "usage: %s [options]\n"
+      "  -games N      games to play, in pairs with the colours swapped (default 100)\n"
+      "  -random N     random plies at the start of each pair (default 8)\n"
+      "  -seed N       seed of the random plies (default: the time)\n"
+      "  -parallel N   games played at once, sharing the search threads (default 4)\n"
+      "  -threads N    search threads (default: one per hardware thread)\n"
+      "  -hash MB      transposition table size\n"
+      "  -book PATH    opening book both sides play from\n"
+      "  -record PATH  append every searched position and its score to a record file\n"
+      "  -a SPEC       the first configuration (default depth=6)\n"
+      "  -b SPEC       the second configuration (default depth=6)\n"
+      "SPEC is a comma separated list of key=value, the keys are depth (0 for no limit), time (ms\n"
+      "on the side's clock for the game, 0 for none), ponder and lazy (0 or 1, searching on the\n"
+      "opponent's time and lazy smp) and the evaluation weights corner, stable, csquare, xsquare,\n"
+      "edge, mobility, potential and frontier\n",
+      name);
+}
+
+/**
+ * \brief reads a configuration
+ * \param spec comma separated key=value pairs
+ * \param config the configuration to change
+ * \return false if the spec is invalid
+ */
+static bool parse_config(const char *spec, Config *config) {
+  while (*spec != '\0') {
+    const char *end = strchr(spec, ',');
+    const size_t length = end != NULL ? (size_t)(end - spec) : strlen(spec);
+    char key[32];
+    long long value;
+    if (length >= sizeof(key) || sscanf(spec, "%31[^=]=%lld", key, &value) != 2 || value < 0) {
+      return false;
+    }
+
+    if (strcmp(key, "depth") == 0 && value <= BOARD_SIZE * BOARD_SIZE) {
+      config->depth = (int)value;
+    } else if (strcmp(key, "time") == 0 && value <= UINT32_MAX) {
+      config->clock = (uint32_t)value;
+    } else if (strcmp(key, "ponder") == 0 && value <= 1) {
+      config->ponder = value == 1;
+    } else if (strcmp(key, "lazy") == 0 && value <= 1) {
+      config->lazy = value == 1;
+    } else if (strcmp(key, "corner") == 0) {
+      config->weights.corner = (int)value;
+    } else if (strcmp(key, "stable") == 0) {
+      config->weights.stable = (int)value;
+    } else if (strcmp(key, "csquare") == 0) {
+      config->weights.cSquare = (int)value;
+    } else if (strcmp(key, "xsquare") == 0) {
+      config->weights.xSquare = (int)value;
+    } else if (strcmp(key, "edge") == 0) {
+      config->weights.edge = (int)value;
+    } else if (strcmp(key, "mobility") == 0) {
+      config->weights.mobility = (int)value;
+    } else if (strcmp(key, "potential") == 0) {
+      config->weights.potentialMobility = (int)value;
+    } else if (strcmp(key, "frontier") == 0) {
+      config->weights.frontier = (int)value;
+    } else {
+      return false;
+    }
+    spec += end != NULL ? length + 1 : length;
+  }
+  // a side without a depth limit needs a clock to stop it
+  return config->depth > 0 || config->clock > 0;
+}
+
+/**
+ * \brief plays random moves from the start
+ * \param opening set to the board after the moves
+ * \param plies how many moves to play
+ */
+static void random_opening(Opening *opening, const int plies) {
+  opening->player = 1ULL << 27 | 1ULL << 36;
+  opening->opponent = 1ULL << 28 | 1ULL << 35;
+  for (int i = 0; i < plies; ++i) {
+    uint64_t moves = engine_legal_moves(opening->player, opening->opponent);
+    if (moves == 0) break;
+
+    for (int skip = rand() % popcount(moves); skip > 0; --skip) {
+      moves &= moves - 1;
+    }
+    engine_play(&opening->player, &opening->opponent, (uint8_t)ctz(moves));
+    opening->side ^= 1;
+  }
+}
+
+/**
+ * \return the wall clock time in microseconds
+ */
+static uint64_t time_us(void) {
+  struct timespec now;
+  timespec_get(&now, TIME_UTC);
+  return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+/**
+ * \brief sets up an engine to play as a configuration
+ */
+static void configure_engine(const Config *config) {
+  engine_set_move_log(false);
+  engine_set_evaluator(config->evaluator);
+  engine_set_depth_limit(config->depth);
+  engine_set_search_mode(config->lazy ? SEARCH_LAZY : SEARCH_SPLIT);
+  engine_set_ponder(config->ponder);
+}
+
+/**
+ * \brief plays games until there are none left, each side with an engine of its own
+ * \param args the Worker to add the results to
+ */
+static int worker_run(void *args) {
+  Worker *worker = args;
+  Engine *sides[2] = {engine_create(), engine_create()};
+  if (sides[0] == NULL || sides[1] == NULL) {
+    engine_destroy(sides[0]);
+    engine_destroy(sides[1]);
+    worker->failed = true;
+    return 0;
+  }
+  for (int i = 0; i < 2; ++i) {
+    engine_select(sides[i]);
+    configure_engine(&configs[i]);
+  }
+
+  for (int game = atomic_fetch_add(&nextGame, 1); game < games;
+       game = atomic_fetch_add(&nextGame, 1)) {
+    uint64_t player = openings[game].player;
+    uint64_t opponent = openings[game].opponent;
+    int side = openings[game].side;
+    // microseconds left on each side's clock
+    int64_t clocks[2] = {(int64_t)configs[0].clock * 1000, (int64_t)configs[1].clock * 1000};
+    for (int i = 0; i < 2; ++i) {
+      engine_select(sides[i]);
+      engine_reset();
+    }
+
+    // the side that ran out of time, if one did
+    int timedOut = -1;
+    while (timedOut < 0) {
+      if (engine_legal_moves(player, opponent) == 0) {
+        if (engine_legal_moves(opponent, player) == 0) break;
+        // pass
+        const uint64_t tiles = player;
+        player = opponent;
+        opponent = tiles;
+        side ^= 1;
+      }
+
+      engine_select(sides[side]);
+      // without a clock the depth limit decides how long a move takes
+      const double left = configs[side].clock > 0 ? clocks[side] / 1e6 : 1e9;
+      const uint64_t start = time_us();
+      const uint8_t move = engine_move(player, opponent, left);
+      const uint64_t took = time_us() - start;
+      EngineStats engineStats;
+      engine_stats(&engineStats);
+
+      Stats *stats = &worker->stats[side];
+      stats->moves++;
+      stats->nodes += engineStats.nodes;
+      stats->time += took;
+      if (took > stats->maxTime) stats->maxTime = took;
+      clocks[side] -= (int64_t)took;
+      if (configs[side].clock > 0 && clocks[side] < 0) {
+        stats->timeouts++;
+        timedOut = side;
+        break;
+      }
+
+      engine_play(&player, &opponent, move);
+      side ^= 1;
+    }
+
+    // from the first configuration's side
+    if (timedOut >= 0) {
+      worker->results[timedOut == 0 ? 2 : 0]++;
+    } else {
+      int diff = popcount(player) - popcount(opponent);
+      if (side == 1) diff = -diff;
+      worker->results[diff > 0 ? 0 : (diff == 0 ? 1 : 2)]++;
+      worker->discs += diff;
+      worker->finished++;
+    }
+  }
+
+  engine_select(NULL);
+  engine_destroy(sides[0]);
+  engine_destroy(sides[1]);
+  return 0;
+}
+
+int main(const int argc, char **argv) {
+  games = 100;
+  int randomPlies = 8;
+  unsigned int seed = (unsigned int)time(NULL);
+  int parallel = 4;
+  int threads = 0;
+  long long hash = 0;
+  const char *bookPath = NULL;
+  const char *recordPath = NULL;
+  for (int i = 0; i < 2; ++i) {
+    configs[i] = (Config){.depth = 6, .clock = 0, .ponder = false, .lazy = false};
+    engine_default_weights(&configs[i].weights);
+  }
+
+  for (int i = 1; i < argc; ++i) {
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    bool valid = value != NULL;
+    if (valid && strcmp(argv[i], "-games") == 0) {
+      games = atoi(value);
+      valid = games > 0;
+    } else if (valid && strcmp(argv[i], "-random") == 0) {
+      randomPlies = atoi(value);
+      valid = randomPlies >= 0;
+    } else if (valid && strcmp(argv[i], "-seed") == 0) {
+      seed = (unsigned int)strtoul(value, NULL, 10);
+    } else if (valid && strcmp(argv[i], "-parallel") == 0) {
+      parallel = atoi(value);
+      valid = parallel > 0;
+    } else if (valid && strcmp(argv[i], "-threads") == 0) {
+      threads = atoi(value);
+      valid = threads > 0;
+    } else if (valid && strcmp(argv[i], "-hash") == 0) {
+      hash = atoll(value);
+      valid = hash > 0;
+    } else if (valid && strcmp(argv[i], "-book") == 0) {
+      bookPath = value;
+    } else if (valid && strcmp(argv[i], "-record") == 0) {
+      recordPath = value;
+    } else if (valid && (strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "-b") == 0)) {
+      valid = parse_config(value, &configs[argv[i][1] - 'a']);
+    } else {
+      valid = false;
+    }
+    if (!valid) {
+      usage(argv[0]);
+      return 2;
+    }
+    ++i;
+  }
+
+  if (!engine_init(threads) || (hash > 0 && !engine_set_hash_size((size_t)hash))) {
+    fprintf(stderr, "failed to start the engine\n");
+    return 1;
+  }
+  if (bookPath != NULL && engine_load_book(bookPath) < 0) {
+    fprintf(stderr, "could not load book %s\n", bookPath);
+    return 1;
+  }
+  if (recordPath != NULL && !engine_record_open(recordPath)) {
+    fprintf(stderr, "could not open record file %s\n", recordPath);
+    return 1;
+  }
+  for (int i = 0; i < 2; ++i) {
+    configs[i].evaluator = engine_evaluator_create(&configs[i].weights);
+    if (configs[i].evaluator == NULL) {
+      fprintf(stderr, "out of memory\n");
+      return 1;
+    }
+  }
+
+  // pairs of games share an opening, with the first configuration moving first in one of them
+  games += games % 2;
+  parallel = parallel < games ? parallel : games;
+  Opening *boards = malloc(sizeof(Opening) * games);
+  Worker *workers = calloc(parallel, sizeof(Worker));
+  if (boards == NULL || workers == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  srand(seed);
+  for (int i = 0; i < games; i += 2) {
+    boards[i] = (Opening){.side = 0};
+    random_opening(&boards[i], randomPlies);
+    boards[i + 1] = boards[i];
+    boards[i + 1].side ^= 1;
+  }
+  openings = boards;
+
+  const clock_t start = clock();
+  const uint64_t startTime = time_us();
+  int started = 0;
+  for (; started < parallel; ++started) {
+    if (thrd_create(&workers[started].thread, worker_run, &workers[started]) != thrd_success) break;
+  }
+  if (started == 0) {
+    fprintf(stderr, "could not start the game threads\n");
+    return 1;
+  }
+
+  int results[3] = {0, 0, 0};
+  long long discs = 0;
+  int finished = 0;
+  Stats stats[2] = {{0}, {0}};
+  bool failed = false;
+  for (int w = 0; w < started; ++w) {
+    const Worker *worker = &workers[w];
+    thrd_join(worker->thread, NULL);
+    failed |= worker->failed;
+    for (int i = 0; i < 3; ++i) {
+      results[i] += worker->results[i];
+    }
+    discs += worker->discs;
+    finished += worker->finished;
+    for (int i = 0; i < 2; ++i) {
+      stats[i].moves += worker->stats[i].moves;
+      stats[i].nodes += worker->stats[i].nodes;
+      stats[i].time += worker->stats[i].time;
+      stats[i].timeouts += worker->stats[i].timeouts;
+      if (worker->stats[i].maxTime > stats[i].maxTime) stats[i].maxTime = worker->stats[i].maxTime;
+    }
+  }
+  const double cpu = (double)(clock() - start) / CLOCKS_PER_SEC;
+  const double wall = (time_us() - startTime) / 1e6;
+
+  const int played = results[0] + results[1] + results[2];
+  if (failed) {
+    fprintf(stderr, "out of memory, some games were not played\n");
+  }
+  printf("%i games (seed %u), %.1fs wall, %.1fs cpu\n", played, seed, wall, cpu);
+  if (played > 0) {
+    printf("a vs b: W/D/L %i/%i/%i, score %.1f%%, average disc differential %+.2f\n",
+        results[0],
+        results[1],
+        results[2],
+        100.0 * (results[0] + results[1] * 0.5) / played,
+        finished > 0 ? (double)discs / finished : 0.0);
+  }
+  for (int i = 0; i < 2; ++i) {
+    const Stats *side = &stats[i];
+    const double seconds = side->time / 1e6;
+    printf("%c: %llu moves, %.0f nodes/s, %.3fms/move (max %.1fms), %i lost on time\n",
+        'a' + i,
+        (unsigned long long)side->moves,
+        seconds > 0 ? side->nodes / seconds : 0.0,
+        side->moves > 0 ? side->time / 1e3 / side->moves : 0.0,
+        side->maxTime / 1e3,
+        side->timeouts);
+  }
+
+  engine_record_close();
+  free(workers);
+  free(boards);
+  for (int i = 0; i < 2; ++i) {
+    engine_evaluator_destroy(configs[i].evaluator);
+  }
+  return failed ? 1 : 0;
+}